@@ -0,0 +1,44 @@
+#ifndef BATCH_TEXTURE_SHADER_H
+#define BATCH_TEXTURE_SHADER_H
+
+#include "matrix.h"
+#include "Color.h"
+#include "VertexUtils.h"
+#include "Sampler2D.h"
+
+// Como o TextureShader, mas o Render3D entrega os fragmentos de 8 em 8
+// e a textura é amostrada de uma vez com Sampler2D::sample8.
+// A textura não é copiada: o Sampler2D pertence a quem desenha.
+struct BatchTextureShader{
+	struct Varying{
+		vec4 position;
+		vec2 texCoords;
+	};
+
+	mat4 M;
+	const Sampler2D* texture = nullptr;
+
+	template<class Vertex>
+	void vertexShader(Vertex in, Varying& out){
+		out.position = M*getPosition(in);
+		out.texCoords = in.texCoords;
+	}
+
+	void fragmentShader(Varying V, RGB& fragColor){
+		fragColor = texture->sample(V.texCoords);
+	}
+
+	void fragmentShader(const Varying* V, unsigned int n, RGB* const* fragColor){
+		float u[8] = {}, v[8] = {};
+		RGB colors[8];
+		for(unsigned int i = 0; i < n; i++){
+			u[i] = V[i].texCoords[0];
+			v[i] = V[i].texCoords[1];
+		}
+		texture->sample8(u, v, colors, n);
+		for(unsigned int i = 0; i < n; i++)
+			*fragColor[i] = colors[i];
+	}
+};
+
+#endif
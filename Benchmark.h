@@ -0,0 +1,130 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Image.h"
+
+// Menor tempo, em milissegundos, entre reps execuções de f.
+template <class F>
+double time_ms(F f, int reps = 5)
+{
+	double best = 1e30;
+	for (int i = 0; i < reps; i++)
+	{
+		auto t0 = std::chrono::steady_clock::now();
+		f();
+		auto t1 = std::chrono::steady_clock::now();
+		best = std::min(best, std::chrono::duration<double, std::milli>(t1 - t0).count());
+	}
+	return best;
+}
+
+inline bool same_pixels(const ImageRGB &A, const ImageRGB &B)
+{
+	return A.width() == B.width() && A.height() == B.height() &&
+		   memcmp(A.data(), B.data(), A.width() * A.height() * sizeof(RGB)) == 0;
+}
+
+// percentil p (0 a 100) dos tempos, com o valor mais próximo (sem interpolação)
+inline double percentile(std::vector<double> times, double p)
+{
+	if (times.empty())
+		return 0;
+	size_t k = std::min(times.size() - 1, (size_t)(p / 100 * times.size()));
+	std::nth_element(times.begin(), times.begin() + k, times.end());
+	return times[k];
+}
+
+// Números pseudoaleatórios reprodutíveis: o mt19937 é definido pelo padrão, mas as
+// distribuições da biblioteca padrão não, e mudam de um compilador para outro
+struct BenchRandom
+{
+	std::mt19937 rng;
+
+	explicit BenchRandom(uint32_t seed) : rng{seed} {}
+
+	// uniforme em [a, b)
+	float operator()(float a, float b) { return a + (b - a) * (float)(rng() / 4294967296.0); }
+};
+
+// Resultado de uma medição da suíte: o menor tempo e o trabalho feito em cada execução
+struct BenchResult
+{
+	std::string name; // grupo/variante/carga
+	double ms;
+	uint64_t primitives, pixels;
+
+	double mtris() const { return ms > 0 ? primitives / ms / 1000 : 0; }
+	double mpixs() const { return ms > 0 ? pixels / ms / 1000 : 0; }
+};
+
+// Resultados da suíte, impressos à medida que chegam e gravados em JSON para comparar execuções
+class BenchReport
+{
+public:
+	std::vector<BenchResult> results;
+	int width, height;
+
+	BenchReport(int width, int height) : width{width}, height{height} {}
+
+	void add(const std::string &name, double ms, uint64_t primitives, uint64_t pixels)
+	{
+		results.push_back({name, ms, primitives, pixels});
+		const BenchResult &r = results.back();
+		printf("%-40s %10.3f ms %10.2f Mtri/s %10.2f Mpix/s\n", name.c_str(), r.ms, r.mtris(), r.mpixs());
+		fflush(stdout);
+	}
+
+	std::string json() const
+	{
+		char date[32];
+		time_t now = time(nullptr);
+		strftime(date, sizeof date, "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+		std::string s = "{\n";
+		s += std::string("  \"date\": \"") + date + "\",\n";
+#if defined(__VERSION__)
+		s += std::string("  \"compiler\": \"") + __VERSION__ + "\",\n";
+#endif
+#if defined(__AVX2__)
+		s += "  \"avx2\": true,\n";
+#else
+		s += "  \"avx2\": false,\n";
+#endif
+		s += "  \"threads\": " + std::to_string(std::max(1u, std::thread::hardware_concurrency())) + ",\n";
+		s += "  \"width\": " + std::to_string(width) + ",\n";
+		s += "  \"height\": " + std::to_string(height) + ",\n";
+		s += "  \"results\": [\n";
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const BenchResult &r = results[i];
+			char line[512];
+			snprintf(line, sizeof line,
+					 "    {\"name\": \"%s\", \"ms\": %.4f, \"primitives\": %llu, \"pixels\": %llu, "
+					 "\"mtri_per_s\": %.4f, \"mpix_per_s\": %.4f}%s\n",
+					 r.name.c_str(), r.ms, (unsigned long long)r.primitives, (unsigned long long)r.pixels, r.mtris(),
+					 r.mpixs(), i + 1 < results.size() ? "," : "");
+			s += line;
+		}
+		s += "  ]\n}\n";
+		return s;
+	}
+
+	bool write(const std::string &file) const
+	{
+		FILE *f = fopen(file.c_str(), "w");
+		if (!f)
+			return false;
+		std::string s = json();
+		bool ok = fwrite(s.data(), 1, s.size(), f) == s.size();
+		return fclose(f) == 0 && ok;
+	}
+};
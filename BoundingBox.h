@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include "vec.h"
+#include "matrix.h"
+#include "VertexUtils.h"
+#include "Clip3D.h"
+
+// Caixa alinhada aos eixos (AABB); vazia enquanto nenhum ponto foi incluído
+struct AABB
+{
+	vec3 min = {INFINITY, INFINITY, INFINITY};
+	vec3 max = {-INFINITY, -INFINITY, -INFINITY};
+
+	bool empty() const { return min[0] > max[0]; }
+
+	void add(vec3 p)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			min[k] = std::min(min[k], p[k]);
+			max[k] = std::max(max[k], p[k]);
+		}
+	}
+
+	void add(const AABB &box)
+	{
+		if (!box.empty())
+		{
+			add(box.min);
+			add(box.max);
+		}
+	}
+};
+
+// caixa das posições dos vértices first, ..., first+n-1 de V
+template <class Vertices>
+AABB boundingBox(const Vertices &V, size_t first, size_t n)
+{
+	AABB box;
+	for (size_t i = first; i < first + n; i++)
+		box.add(toVec3(getPosition(V[i])));
+	return box;
+}
+
+// Posição de um volume em relação ao volume de visão
+enum FrustumTest
+{
+	FRUSTUM_OUTSIDE,	// nada visível: nem precisa passar pelo vertexShader
+	FRUSTUM_INTERSECTS, // as primitivas são recortadas
+	FRUSTUM_INSIDE		// tudo dentro: o recorte pode ser pulado
+};
+
+// Testa a caixa, transformada por M, contra os planos de normals().
+// Os testes são lineares nas coordenadas homogêneas, então basta olhar os 8 vértices da caixa:
+// se todos estão dentro, a caixa está dentro; se todos estão fora de um mesmo plano, está fora.
+inline FrustumTest frustumTest(const mat4 &M, const AABB &box)
+{
+	if (box.empty())
+		return FRUSTUM_OUTSIDE;
+
+	unsigned int all = 0x3f, any = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		vec4 p = {
+			i & 1 ? box.max[0] : box.min[0],
+			i & 2 ? box.max[1] : box.min[1],
+			i & 4 ? box.max[2] : box.min[2],
+			1};
+		unsigned int code = outcode(M * p);
+		all &= code;
+		any |= code;
+	}
+
+	if (all)
+		return FRUSTUM_OUTSIDE;
+	return any ? FRUSTUM_INTERSECTS : FRUSTUM_INSIDE;
+}
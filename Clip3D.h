@@ -1,8 +1,11 @@
 #ifndef CLIP3D_H
 #define CLIP3D_H
+#include <array>
+#include <vector>
 #include "vec.h"
 #include "VertexUtils.h"
 #include "Primitives.h"
+#include "Profiler.h"
 
 inline std::array<vec4, 6> normals()
 {
@@ -15,12 +18,31 @@ inline std::array<vec4, 6> normals()
 		vec4{0, -1, 0, 1}};
 }
 
+// bit i ligado se P está fora do semiespaço definido por normals()[i]
+inline unsigned int outcode(vec4 P)
+{
+	float x = P[0], y = P[1], z = P[2], w = P[3];
+	return (w - z < 0) << 0 |
+		   (w + z < 0) << 1 |
+		   (w + x < 0) << 2 |
+		   (w - x < 0) << 3 |
+		   (w + y < 0) << 4 |
+		   (w - y < 0) << 5;
+}
+
 template <class Varying>
 bool clip(Line<Varying> &line)
 {
 	vec4 A = line[0].position;
 	vec4 B = line[1].position;
 
+	unsigned int ca = outcode(A);
+	unsigned int cb = outcode(B);
+	if ((ca | cb) == 0)
+		return true;
+	if (ca & cb)
+		return false;
+
 	float t_in = 0;
 	float t_out = 1;
 
@@ -56,13 +78,20 @@ bool clip(Line<Varying> &line)
 	return true;
 }
 
+template <class Varying, class F>
+void clip(Line<Varying> line, F f)
+{
+	if (clip(line))
+		f(line);
+}
+
 template <class Varying>
 std::vector<Line<Varying>> clip(const std::vector<Line<Varying>> &lines)
 {
 	std::vector<Line<Varying>> res;
-	for (Line<Varying> line : lines)
-		if (clip(line))
-			res.push_back(line);
+	res.reserve(lines.size());
+	for (const Line<Varying> &line : lines)
+		clip(line, [&](const Line<Varying> &l) { res.push_back(l); });
 	return res;
 }
 
@@ -111,19 +140,104 @@ std::vector<Varying> clip(const std::vector<Varying> &polygon)
 	return R;
 }
 
+/******************************************************************************/
+
+// Polígono de capacidade fixa, na pilha: recortar um triângulo pelos
+// 6 planos acrescenta no máximo um vértice por plano.
 template <class Varying>
-std::vector<Triangle<Varying>> clip(const std::vector<Triangle<Varying>> &tris)
+struct ClipPolygon
 {
-	std::vector<Triangle<Varying>> res;
+	static constexpr unsigned int capacity = 9;
+
+	Varying v[capacity];
+	unsigned int n = 0;
+};
+
+template <class Varying>
+void clip(const ClipPolygon<Varying> &polygon, vec4 n, ClipPolygon<Varying> &R)
+{
+	R.n = 0;
+	for (unsigned int i = 0; i < polygon.n; i++)
+	{
+		const Varying &P = polygon.v[i];
+		const Varying &Q = polygon.v[(i + 1) % polygon.n];
+
+		float dotP = dot(getPosition(P), n);
+		float dotQ = dot(getPosition(Q), n);
+
+		bool Pin = dotP >= 0;
+		bool Qin = dotQ >= 0;
+
+		if (Pin != Qin)
+		{
+			float t = dotP / (dotP - dotQ);
+			asVec(R.v[R.n++]) = (1.0 - t) * asVec(P) + t * asVec(Q);
+		}
+		if (Qin)
+			R.v[R.n++] = Q;
+	}
+}
+
+// Chama f(T) para cada triângulo T resultante do recorte de tri.
+// Triângulos inteiramente dentro ou fora são decididos pelos outcodes dos vértices;
+// os demais são recortados só pelos planos que cruzam, sem alocar memória.
+template <class Varying, class F>
+void clip(const Triangle<Varying> &tri, F f)
+{
+	unsigned int c0 = outcode(getPosition(tri[0]));
+	unsigned int c1 = outcode(getPosition(tri[1]));
+	unsigned int c2 = outcode(getPosition(tri[2]));
+
+	if ((c0 | c1 | c2) == 0)
+	{
+		f(tri);
+		return;
+	}
 
-	for (Triangle<Varying> tri : tris)
+	ThreadProfile *profile = profiling();
+	if (c0 & c1 & c2)
 	{
-		std::vector<Varying> polygon = {tri[0], tri[1], tri[2]};
-		polygon = clip(polygon);
-		TriangleFan T{polygon.size()};
-		for (Triangle<Varying> tri : assemble(T, polygon))
-			res.push_back(tri);
+		if (profile)
+			profile->counters.primitives_outside++;
+		return;
 	}
+	if (profile)
+		profile->counters.primitives_clipped++;
+
+	ClipPolygon<Varying> buffers[2];
+	ClipPolygon<Varying> *A = &buffers[0];
+	ClipPolygon<Varying> *B = &buffers[1];
+	A->v[0] = tri[0];
+	A->v[1] = tri[1];
+	A->v[2] = tri[2];
+	A->n = 3;
+
+	unsigned int planes = c0 | c1 | c2;
+	std::array<vec4, 6> N = normals();
+	for (int i = 0; i < 6; i++)
+	{
+		if (!(planes >> i & 1))
+			continue;
+
+		clip(*A, N[i], *B);
+		std::swap(A, B);
+		if (A->n < 3)
+			return;
+	}
+
+	for (unsigned int i = 1; i + 1 < A->n; i++)
+		f(Triangle<Varying>{A->v[0], A->v[i], A->v[i + 1]});
+}
+
+template <class Varying>
+std::vector<Triangle<Varying>> clip(const std::vector<Triangle<Varying>> &tris)
+{
+	std::vector<Triangle<Varying>> res;
+	res.reserve(tris.size());
+
+	for (const Triangle<Varying> &tri : tris)
+		clip(tri, [&](const Triangle<Varying> &T) { res.push_back(T); });
+
 	return res;
 }
 
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include "vec.h"
+#include "matrix.h"
+#include "VertexUtils.h"
+#include "BoundingBox.h"
+
+// Grupo de triângulos consecutivos da malha, com a caixa envolvente e um cone de normais.
+// O cone (como no meshoptimizer) permite descartar o grupo quando todos os triângulos
+// estão de costas para a câmera.
+struct Cluster
+{
+	AABB box;
+	uint32_t first, count; // em vértices (3 por triângulo), como MaterialRange
+	vec3 cone_apex, cone_axis;
+	float cone_cutoff; // maior que 1: o cone é largo demais para descartar o grupo
+};
+
+// Nó da hierarquia de caixas (BVH) sobre os clusters.
+// Folha (count > 0): clusters first, ..., first+count-1. Nó interno: filhos first e first+1.
+struct BVHNode
+{
+	AABB box;
+	uint32_t first, count;
+};
+
+// Triângulos a desenhar: clusters visíveis e consecutivos juntados em uma faixa
+struct ClusterRange
+{
+	unsigned int first, count; // em vértices
+	FrustumTest visibility;	   // FRUSTUM_INSIDE: a faixa pode ser desenhada sem recorte
+};
+
+struct ClusterCullStats
+{
+	size_t nodes_tested = 0;   // nós da BVH testados contra o volume de visão
+	size_t clusters_drawn = 0; // clusters visíveis
+	size_t backface_culled = 0;
+	size_t triangles_drawn = 0;
+};
+
+// Reordena os triângulos dos vértices first, ..., first+count-1 de V em clusters de até
+// cluster_size triângulos, próximos e com normais parecidas.
+// Acrescenta os nós e clusters em nodes e clusters e devolve o índice da raiz.
+template <class Vertex>
+unsigned int buildClusterBVH(Vertex *V, unsigned int first, unsigned int count, std::vector<BVHNode> &nodes,
+							 std::vector<Cluster> &clusters, unsigned int cluster_size = 128)
+{
+	unsigned int n = count / 3;
+	std::vector<Vertex> tris(V + first, V + first + 3 * n);
+	auto position = [&](unsigned int t, int k) { return toVec3(getPosition(tris[3 * t + k])); };
+
+	// Centro e orientação de cada triângulo: o eixo dominante da normal com o sinal (6 grupos).
+	// Nós grandes são divididos pela mediana dos centros; os de até 8 clusters são separados antes
+	// pela orientação, e assim os clusters ficam com cones de normais estreitos.
+	std::vector<unsigned int> order(n);
+	std::vector<vec3> centroid(n);
+	std::vector<unsigned char> facing(n);
+	for (unsigned int t = 0; t < n; t++)
+	{
+		vec3 a = position(t, 1) - position(t, 0), b = position(t, 2) - position(t, 0);
+		vec3 normal = {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+		int j = fabs(normal[0]) > fabs(normal[1]) ? (fabs(normal[0]) > fabs(normal[2]) ? 0 : 2)
+												  : (fabs(normal[1]) > fabs(normal[2]) ? 1 : 2);
+		order[t] = t;
+		centroid[t] = (1.0f / 3) * (position(t, 0) + position(t, 1) + position(t, 2));
+		facing[t] = 2 * j + (normal[j] < 0);
+	}
+
+	struct Task
+	{
+		unsigned int node, lo, hi; // triângulos order[lo], ..., order[hi-1]
+		bool grouped;			   // já ordenados por orientação
+	};
+
+	unsigned int root = nodes.size();
+	nodes.emplace_back();
+	std::vector<Task> stack = {{root, 0, n, false}};
+	while (!stack.empty())
+	{
+		Task task = stack.back();
+		stack.pop_back();
+
+		if (task.hi - task.lo <= cluster_size)
+		{
+			Cluster c;
+			c.first = first + 3 * task.lo;
+			c.count = 3 * (task.hi - task.lo);
+
+			// eixo do cone: média das normais; o ângulo é o da normal mais afastada.
+			// Triângulos degenerados (normal nula) não são desenhados e ficam de fora.
+			std::vector<vec3> N;
+			vec3 sum = {0, 0, 0};
+			for (unsigned int i = task.lo; i < task.hi; i++)
+			{
+				vec3 p[] = {position(order[i], 0), position(order[i], 1), position(order[i], 2)};
+				for (vec3 q : p)
+					c.box.add(q);
+
+				vec3 a = p[1] - p[0], b = p[2] - p[0];
+				vec3 normal = {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+				float len = norm(normal);
+				N.push_back(len > 0 ? (1 / len) * normal : vec3{0, 0, 0});
+				sum = sum + N.back();
+			}
+
+			float len = norm(sum);
+			c.cone_axis = len > 0 ? (1 / len) * sum : vec3{0, 0, 1};
+			float mindp = 1;
+			for (vec3 normal : N)
+				if (dot(normal, normal) > 0)
+					mindp = std::min(mindp, dot(normal, c.cone_axis));
+
+			// vértice do cone: no eixo, atrás dos planos de todos os triângulos
+			vec3 center = 0.5f * (c.box.min + c.box.max);
+			float maxt = 0;
+			for (unsigned int i = task.lo; i < task.hi && mindp > 0.1f; i++)
+			{
+				vec3 normal = N[i - task.lo];
+				if (dot(normal, normal) > 0)
+					maxt = std::max(maxt, dot(center - position(order[i], 0), normal) / dot(c.cone_axis, normal));
+			}
+			c.cone_apex = center - maxt * c.cone_axis;
+			c.cone_cutoff = mindp > 0.1f ? sqrtf(1 - mindp * mindp) : 2;
+
+			nodes[task.node].box = c.box;
+			nodes[task.node].first = clusters.size();
+			nodes[task.node].count = 1;
+			clusters.push_back(c);
+			continue;
+		}
+
+		auto begin = order.begin() + task.lo, end = order.begin() + task.hi;
+		if (!task.grouped && task.hi - task.lo <= 8 * cluster_size)
+		{
+			std::stable_sort(begin, end, [&](unsigned int a, unsigned int b) { return facing[a] < facing[b]; });
+			task.grouped = true;
+		}
+
+		// divide na troca de orientação mais perto do meio; sem troca, na mediana do eixo mais longo
+		unsigned int mid = task.lo;
+		if (task.grouped)
+			for (unsigned int i = task.lo + 1; i < task.hi; i++)
+				if (facing[order[i]] != facing[order[i - 1]] &&
+					(mid == task.lo || abs((int)(2 * i) - (int)(task.lo + task.hi)) < abs((int)(2 * mid) - (int)(task.lo + task.hi))))
+					mid = i;
+
+		if (mid == task.lo)
+		{
+			AABB bounds;
+			for (auto it = begin; it != end; ++it)
+				bounds.add(centroid[*it]);
+			vec3 extent = bounds.max - bounds.min;
+			int axis = extent[0] > extent[1] ? (extent[0] > extent[2] ? 0 : 2) : (extent[1] > extent[2] ? 1 : 2);
+
+			mid = (task.lo + task.hi) / 2;
+			std::nth_element(begin, order.begin() + mid, end,
+							 [&](unsigned int a, unsigned int b) { return centroid[a][axis] < centroid[b][axis]; });
+		}
+
+		unsigned int left = nodes.size();
+		nodes.emplace_back();
+		nodes.emplace_back();
+		nodes[task.node].first = left;
+		nodes[task.node].count = 0;
+		stack.push_back({left, task.lo, mid, task.grouped});
+		stack.push_back({left + 1, mid, task.hi, task.grouped});
+	}
+
+	// os filhos vêm depois dos pais: as caixas dos nós internos são feitas de trás para frente
+	for (unsigned int i = nodes.size(); i-- > root;)
+		if (nodes[i].count == 0)
+		{
+			nodes[i].box = nodes[nodes[i].first].box;
+			nodes[i].box.add(nodes[nodes[i].first + 1].box);
+		}
+
+	for (unsigned int i = 0; i < n; i++)
+		for (int k = 0; k < 3; k++)
+			V[first + 3 * i + k] = tris[3 * order[i] + k];
+	return root;
+}
+
+// Posição da câmera nas coordenadas do objeto, para a matriz M que leva à posição de recorte:
+// o ponto (homogêneo) com x, y e w de recorte nulos, ortogonal às linhas 0, 1 e 3 de M.
+// Em uma projeção ortográfica w = 0 e xyz é a direção que aponta para a câmera.
+inline vec4 eyePosition(const mat4 &M)
+{
+	vec4 C[4] = {M * vec4{1, 0, 0, 0}, M * vec4{0, 1, 0, 0}, M * vec4{0, 0, 1, 0}, M * vec4{0, 0, 0, 1}};
+	int rows[3] = {0, 1, 3};
+
+	// produto vetorial generalizado: cofatores da matriz 3x4 com as linhas escolhidas
+	vec4 X;
+	for (int i = 0; i < 4; i++)
+	{
+		int c[3], m = 0;
+		for (int j = 0; j < 4; j++)
+			if (j != i)
+				c[m++] = j;
+		auto e = [&](int r, int k) { return C[c[k]][rows[r]]; };
+		float det = e(0, 0) * (e(1, 1) * e(2, 2) - e(1, 2) * e(2, 1)) -
+					e(0, 1) * (e(1, 0) * e(2, 2) - e(1, 2) * e(2, 0)) +
+					e(0, 2) * (e(1, 0) * e(2, 1) - e(1, 1) * e(2, 0));
+		X[i] = i % 2 ? -det : det;
+	}
+
+	vec3 d = toVec3(X);
+	if (fabs(X[3]) > 1e-6f * norm(d))
+		return {X[0] / X[3], X[1] / X[3], X[2] / X[3], 1};
+
+	// câmera no infinito: o sentido certo é o que diminui z, em direção ao plano próximo
+	float dz = C[0][2] * d[0] + C[1][2] * d[1] + C[2][2] * d[2];
+	return dz < 0 ? vec4{d[0], d[1], d[2], 0} : vec4{-d[0], -d[1], -d[2], 0};
+}
+
+// todos os triângulos do cluster estão de costas para a câmera em eye (eyePosition)
+inline bool backfacing(const Cluster &c, vec4 eye)
+{
+	if (c.cone_cutoff > 1)
+		return false;
+
+	vec3 v = eye[3] == 0 ? -1.0f * toVec3(eye) : c.cone_apex - toVec3(eye);
+	float len = norm(v);
+	return len > 0 && dot(v, c.cone_axis) >= c.cone_cutoff * len;
+}
+
+// Percorre a BVH a partir de root e acrescenta em out as faixas de triângulos a desenhar com a matriz M.
+// Nós fora do volume de visão são descartados inteiros; os de dentro não testam mais os filhos.
+// Com backfaces, clusters inteiramente de costas para a câmera também são descartados.
+// Nodes e Clusters podem ser std::vector ou ArrayView (CachedObjMesh).
+template <class Nodes, class Clusters>
+void cullClusters(const Nodes &nodes, const Clusters &clusters, unsigned int root, const mat4 &M, bool backfaces,
+				  std::vector<ClusterRange> &out, ClusterCullStats *stats = nullptr)
+{
+	vec4 eye = eyePosition(M);
+
+	struct Item
+	{
+		unsigned int node;
+		bool inside;
+	};
+	Item stack[64];
+	unsigned int top = 0;
+	stack[top++] = {root, false};
+	while (top > 0)
+	{
+		Item item = stack[--top];
+		const BVHNode &node = nodes[item.node];
+
+		if (stats && !item.inside)
+			stats->nodes_tested++;
+		FrustumTest visibility = item.inside ? FRUSTUM_INSIDE : frustumTest(M, node.box);
+		if (visibility == FRUSTUM_OUTSIDE)
+			continue;
+
+		if (node.count == 0)
+		{
+			bool inside = visibility == FRUSTUM_INSIDE;
+			stack[top++] = {node.first + 1, inside};
+			stack[top++] = {node.first, inside};
+			continue;
+		}
+
+		for (unsigned int i = node.first; i < node.first + node.count; i++)
+		{
+			const Cluster &c = clusters[i];
+			if (backfaces && backfacing(c, eye))
+			{
+				if (stats)
+					stats->backface_culled++;
+				continue;
+			}
+			if (stats)
+			{
+				stats->clusters_drawn++;
+				stats->triangles_drawn += c.count / 3;
+			}
+
+			if (!out.empty() && out.back().first + out.back().count == c.first && out.back().visibility == visibility)
+				out.back().count += c.count;
+			else
+				out.push_back({c.first, c.count, visibility});
+		}
+	}
+}
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+#include "Image.h"
+#include "rasterization.h"
+#include "Render3D.h"
+#include "SoA.h"
+
+// Imagem de 32 bits por pixel com ZBuffer de floats, para desenhar sem o ImageRGB.
+// Cada pixel ocupa 4 bytes: R, G e B nos primeiros, como um RGB, e 255 no último (RGBA).
+// As linhas são alinhadas em 32 bytes e completadas até um múltiplo de 8 pixels, então
+// uma linha de um ladrilho de 8x8 é escrita com uma instrução AVX.
+// fill e clear não escrevem nos pixels: só marcam todos os ladrilhos como limpos (fast clear).
+// Um ladrilho marcado é escrito com a cor e a profundidade de limpeza na primeira vez que é
+// tocado; os que ninguém toca nunca são escritos. O teste de profundidade antecipado usa a marca
+// para aceitar ou descartar blocos inteiros do rasterizador em ladrilhos ainda limpos.
+// A conversão para RGB só acontece em readRGB; pixels() serve para o glDrawPixels com GL_RGBA.
+// Cada ladrilho só é alterado por quem desenha nele, por isso a imagem pode ser usada pelo TiledRender3D.
+class ImageFrameBuffer
+{
+public:
+	static constexpr int tile_size = RASTER_BLOCK;
+	static_assert(tile_size * sizeof(uint32_t) == 32, "uma linha de um ladrilho deve ocupar 32 bytes");
+
+private:
+	enum : unsigned char
+	{
+		CLEAR_COLOR = 1,
+		CLEAR_DEPTH = 2
+	};
+
+	int w, h;
+	int line;	 // pixels por linha, múltiplo de tile_size
+	int tiles_x; // ladrilhos por linha
+	aligned_vector<uint32_t> C;
+	aligned_vector<float> Z;
+	std::vector<unsigned char> tags; // CLEAR_COLOR e CLEAR_DEPTH de cada ladrilho
+
+	uint32_t clear_color = 0xFF000000;
+	float clear_depth = 1;
+
+public:
+	ImageFrameBuffer(int width, int height)
+		: w{width}, h{height}
+	{
+		tiles_x = (w + tile_size - 1) / tile_size;
+		int tiles_y = (h + tile_size - 1) / tile_size;
+		line = tiles_x * tile_size;
+		C.resize((size_t)line * tiles_y * tile_size);
+		Z.resize(C.size());
+		tags.assign((size_t)tiles_x * tiles_y, CLEAR_COLOR | CLEAR_DEPTH);
+	}
+
+	int width() const { return w; }
+	int height() const { return h; }
+
+	// pixels por linha em pixels(), para GL_UNPACK_ROW_LENGTH
+	int stride() const { return line; }
+
+	// pinta a imagem com a cor color, sem escrever nos pixels
+	void fill(RGB color)
+	{
+		clear_color = pack(color);
+		for (unsigned char &t : tags)
+			t |= CLEAR_COLOR;
+	}
+
+	// volta a profundidade para clear_depth, sem escrever no ZBuffer
+	void clear(float depth = 1)
+	{
+		clear_depth = depth;
+		for (unsigned char &t : tags)
+			t |= CLEAR_DEPTH;
+	}
+
+	RGB &operator()(int x, int y)
+	{
+		touch(tile(x, y), CLEAR_COLOR);
+		return *reinterpret_cast<RGB *>(&C[(size_t)y * line + x]);
+	}
+
+	RGB operator()(int x, int y) const
+	{
+		uint32_t c = tags[tile(x, y)] & CLEAR_COLOR ? clear_color : C[(size_t)y * line + x];
+		return unpack(c);
+	}
+
+	float depth(int x, int y) const
+	{
+		return tags[tile(x, y)] & CLEAR_DEPTH ? clear_depth : Z[(size_t)y * line + x];
+	}
+
+	// Testa e, se passar, escreve a profundidade z do pixel p, como no ImageHiZBuffer.
+	// Com mode == DEPTH_PASS o bloco inteiro já passou e só é preciso escrever.
+	bool testFragment(Pixel p, float z, DepthTest mode)
+	{
+		touch(tile(p.x, p.y), CLEAR_DEPTH);
+		float &d = Z[(size_t)p.y * line + p.x];
+		if (mode != DEPTH_PASS && !(z < d))
+			return false;
+		d = z;
+		return true;
+	}
+
+	// B é um bloco do rasterizador, contido em um ladrilho;
+	// [zmin, zmax] é o intervalo de profundidade do triângulo dentro de B
+	DepthTest testBlock(PixelRect B, float zmin, float zmax) const
+	{
+		if (!(tags[tile(B.x0, B.y0)] & CLEAR_DEPTH))
+			return DEPTH_TEST;
+		if (zmin >= clear_depth)
+			return DEPTH_CULL;
+		return zmax < clear_depth ? DEPTH_PASS : DEPTH_TEST;
+	}
+
+	// Pixels RGBA, de baixo para cima como o ImageRGB, com stride() pixels por linha.
+	// Escreve os ladrilhos ainda marcados como limpos.
+	const uint32_t *pixels()
+	{
+		for (size_t t = 0; t < tags.size(); t++)
+			touch(t, CLEAR_COLOR);
+		return C.data();
+	}
+
+	// Converte para RGB em out, que passa a ter o tamanho da imagem
+	void readRGB(ImageRGB &out) const
+	{
+		if (out.width() != w || out.height() != h)
+			out = ImageRGB{w, h};
+
+		RGB clear_rgb = unpack(clear_color);
+		for (int y = 0; y < h; y++)
+		{
+			const uint32_t *in = &C[(size_t)y * line];
+			unsigned char *dst = reinterpret_cast<unsigned char *>(&out(0, y));
+			for (int x0 = 0; x0 < w; x0 += tile_size)
+			{
+				int n = std::min(tile_size, w - x0);
+				if (tags[tile(x0, y)] & CLEAR_COLOR)
+				{
+					for (int i = 0; i < n; i++)
+						memcpy(dst + 3 * (x0 + i), &clear_rgb, 3);
+					continue;
+				}
+#if defined(__AVX2__)
+				// 8 pixels de 4 bytes em 24 bytes: as duas metades são escritas com 16 bytes,
+				// a segunda por cima dos 4 bytes que sobram da primeira; os 4 bytes depois do
+				// fim, ainda na linha, são escritos de novo pelo ladrilho seguinte
+				if (3 * x0 + 28 <= 3 * w)
+				{
+					const __m256i shuffle = _mm256_setr_epi8(
+						0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+						0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+					__m256i v = _mm256_shuffle_epi8(_mm256_load_si256((const __m256i *)(in + x0)), shuffle);
+					_mm_storeu_si128((__m128i *)(dst + 3 * x0), _mm256_castsi256_si128(v));
+					_mm_storeu_si128((__m128i *)(dst + 3 * x0 + 12), _mm256_extracti128_si256(v, 1));
+					continue;
+				}
+#endif
+				for (int i = 0; i < n; i++)
+					memcpy(dst + 3 * (x0 + i), &in[x0 + i], 3);
+			}
+		}
+	}
+
+private:
+	size_t tile(int x, int y) const { return (size_t)(y / tile_size) * tiles_x + x / tile_size; }
+
+	static uint32_t pack(RGB c)
+	{
+		uint32_t p = 0xFF000000;
+		memcpy(&p, &c, 3);
+		return p;
+	}
+
+	static RGB unpack(uint32_t p)
+	{
+		RGB c;
+		memcpy(&c, &p, 3);
+		return c;
+	}
+
+	// escreve os valores de limpeza de bits no ladrilho t, se ainda estiver marcado
+	void touch(size_t t, unsigned char bits)
+	{
+		bits &= tags[t];
+		if (!bits)
+			return;
+
+		size_t first = (t / tiles_x) * tile_size * (size_t)line + (t % tiles_x) * tile_size;
+		for (int j = 0; j < tile_size; j++)
+		{
+			size_t i = first + (size_t)j * line;
+#if defined(__AVX__)
+			if (bits & CLEAR_COLOR)
+				_mm256_store_si256((__m256i *)&C[i], _mm256_set1_epi32(clear_color));
+			if (bits & CLEAR_DEPTH)
+				_mm256_store_ps(&Z[i], _mm256_set1_ps(clear_depth));
+#else
+			if (bits & CLEAR_COLOR)
+				std::fill_n(&C[i], tile_size, clear_color);
+			if (bits & CLEAR_DEPTH)
+				std::fill_n(&Z[i], tile_size, clear_depth);
+#endif
+		}
+		tags[t] &= ~bits;
+	}
+};
+
+// Teste antecipado com as marcas de limpeza: blocos em ladrilhos limpos passam ou são descartados inteiros
+inline DepthTest earlyBlockTest(ImageFrameBuffer &img, PixelRect B, float zmin, float zmax)
+{
+	return img.testBlock(B, zmin, zmax);
+}
+
+inline bool earlyDepthTest(ImageFrameBuffer &img, Pixel p, float z, DepthTest mode)
+{
+	return img.testFragment(p, z, mode);
+}
+
+template <class Varying>
+bool testPixel(Pixel p, Varying, ImageFrameBuffer &img)
+{
+	return p.x >= 0 && p.y >= 0 && p.x < img.width() && p.y < img.height();
+}
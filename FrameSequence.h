@@ -0,0 +1,166 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Image.h"
+#include "ThreadPool.h"
+
+// Tempos, em milissegundos, de cada quadro e da sequência inteira
+struct FrameTimes
+{
+	std::vector<double> render_ms, encode_ms;
+	double total_ms = 0;
+};
+
+// Verdadeiro se o alvo do desenho (ZBuffer, ...) pode ser limpo para reaproveitamento com clear()
+template <class Target, class = void>
+struct has_clear : std::false_type
+{
+};
+
+template <class Target>
+struct has_clear<Target, std::void_t<decltype(std::declval<Target &>().clear())>> : std::true_type
+{
+};
+
+// Renderiza uma sequência de quadros independentes (uma animação) em paralelo e grava os quadros em outras threads.
+// Cada quadro usa uma imagem e um Target (ImageZBuffer, ImageHiZBuffer, ...) de um conjunto fixo,
+// reaproveitados de um quadro para o outro. Os quadros prontos esperam a gravação em uma fila limitada:
+// quando ela enche, o desenho espera, e a memória não cresce com o número de quadros.
+// Com threads suficientes, n quadros levam perto de max(desenho, gravação), e não a soma.
+template <class Target>
+class FrameSequence
+{
+	struct Frame
+	{
+		int index = -1;
+		ImageRGB image;
+		std::optional<Target> target; // aponta para image: o Frame não muda de lugar
+
+		Frame(int width, int height) : image{width, height} {}
+	};
+
+	unsigned int render_threads, encode_threads;
+	std::vector<std::unique_ptr<Frame>> frames;
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::vector<Frame *> free_frames;
+	std::deque<Frame *> ready; // desenhados, esperando a gravação
+	bool finished = false;
+
+public:
+	// render_threads quadros desenhados ao mesmo tempo e até queue_size quadros esperando a gravação
+	// (por padrão, tantos quanto as threads de desenho)
+	FrameSequence(int width, int height,
+				  unsigned int render_threads = std::thread::hardware_concurrency(),
+				  unsigned int encode_threads = std::thread::hardware_concurrency(),
+				  unsigned int queue_size = 0)
+		: render_threads{std::max(1u, render_threads)}, encode_threads{std::max(1u, encode_threads)}
+	{
+		if (queue_size == 0)
+			queue_size = this->render_threads;
+		for (unsigned int i = 0; i < this->render_threads + queue_size; i++)
+			frames.push_back(std::make_unique<Frame>(width, height));
+	}
+
+	// Chama render(k, image, target) para desenhar o quadro k, k = 0, ..., nframes-1,
+	// e depois save(k, image) em uma das threads de gravação.
+	// Os quadros são desenhados ao mesmo tempo: render não deve alterar estado compartilhado
+	// nem usar o defaultThreadPool, e save é chamado fora de ordem.
+	// Com uma thread de desenho e uma de gravação, os quadros são desenhados na thread que chama run,
+	// que pode usar o defaultThreadPool, e gravados em ordem.
+	template <class Render, class Save>
+	FrameTimes run(int nframes, Render render, Save save)
+	{
+		using clock = std::chrono::steady_clock;
+		auto t0 = clock::now();
+
+		FrameTimes times;
+		times.render_ms.assign(nframes, 0);
+		times.encode_ms.assign(nframes, 0);
+
+		free_frames.clear();
+		for (auto &frame : frames)
+			free_frames.push_back(frame.get());
+		ready.clear();
+		finished = false;
+
+		std::vector<std::thread> encoders;
+		for (unsigned int i = 0; i < encode_threads; i++)
+			encoders.emplace_back([&]
+			{
+				for (;;)
+				{
+					Frame *frame;
+					{
+						std::unique_lock<std::mutex> lock{mutex};
+						changed.wait(lock, [&] { return finished || !ready.empty(); });
+						if (ready.empty())
+							return;
+						frame = ready.front();
+						ready.pop_front();
+					}
+
+					auto t = clock::now();
+					save(frame->index, std::as_const(frame->image));
+					times.encode_ms[frame->index] = std::chrono::duration<double, std::milli>(clock::now() - t).count();
+
+					std::lock_guard<std::mutex> lock{mutex};
+					free_frames.push_back(frame);
+					changed.notify_all();
+				}
+			});
+
+		ThreadPool pool{render_threads};
+		pool.parallel_for(nframes, [&](unsigned int k)
+		{
+			Frame *frame;
+			{
+				std::unique_lock<std::mutex> lock{mutex};
+				changed.wait(lock, [&] { return !free_frames.empty(); });
+				frame = free_frames.back();
+				free_frames.pop_back();
+			}
+
+			auto t = clock::now();
+			if constexpr (has_clear<Target>::value)
+			{
+				if (frame->target)
+					frame->target->clear();
+				else
+					frame->target.emplace(frame->image);
+			}
+			else
+				frame->target.emplace(frame->image);
+
+			frame->index = k;
+			render((int)k, frame->image, *frame->target);
+			times.render_ms[k] = std::chrono::duration<double, std::milli>(clock::now() - t).count();
+
+			std::lock_guard<std::mutex> lock{mutex};
+			ready.push_back(frame);
+			changed.notify_all();
+		});
+
+		{
+			std::lock_guard<std::mutex> lock{mutex};
+			finished = true;
+		}
+		changed.notify_all();
+		for (std::thread &t : encoders)
+			t.join();
+
+		times.total_ms = std::chrono::duration<double, std::milli>(clock::now() - t0).count();
+		return times;
+	}
+};
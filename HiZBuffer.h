@@ -0,0 +1,237 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include "Image.h"
+#include "rasterization.h"
+#include "Render3D.h"
+
+// Contadores do teste de profundidade antecipado
+struct HiZStats
+{
+	size_t triangles_tested = 0, triangles_culled = 0;
+	size_t blocks_tested = 0, blocks_culled = 0, blocks_in_front = 0;
+	size_t fragments_tested = 0, fragments_culled = 0;
+
+	HiZStats &operator+=(const HiZStats &s)
+	{
+		triangles_tested += s.triangles_tested;
+		triangles_culled += s.triangles_culled;
+		blocks_tested += s.blocks_tested;
+		blocks_culled += s.blocks_culled;
+		blocks_in_front += s.blocks_in_front;
+		fragments_tested += s.fragments_tested;
+		fragments_culled += s.fragments_culled;
+		return *this;
+	}
+};
+
+// ZBuffer hierárquico.
+// Além da profundidade de cada pixel guarda, para ladrilhos de 8x8 pixels
+// (um bloco do rasterizador) e de 64x64 pixels, a menor e a maior profundidade.
+// Com isso o Render3D descarta triângulos e blocos inteiros que estão atrás do
+// que já foi desenhado, antes de interpolar os varyings.
+// O teste de profundidade é todo feito em earlyDepthTest; testPixel só confere os limites.
+// Cada ladrilho de 64x64 só é alterado por quem desenha nele, por isso o buffer
+// pode ser usado pelo TiledRender3D sem travas.
+class ImageHiZBuffer
+{
+public:
+	static constexpr int fine_size = RASTER_BLOCK;
+	static constexpr int coarse_size = 8 * RASTER_BLOCK;
+
+private:
+	struct DepthTile
+	{
+		float zmin, zmax;
+		bool dirty; // zmax pode estar desatualizado (maior que o real)
+	};
+
+	ImageRGB &img;
+	std::vector<float> Z;
+
+	int fine_x, coarse_x;
+	std::vector<DepthTile> fine, coarse;
+
+	// contadores por ladrilho de 64x64, para não haver disputa entre threads
+	std::vector<HiZStats> counters;
+
+public:
+	ImageHiZBuffer(ImageRGB &img, float clear_depth = 1)
+		: img{img}, Z(img.width() * img.height(), clear_depth)
+	{
+		fine_x = (img.width() + fine_size - 1) / fine_size;
+		int fine_y = (img.height() + fine_size - 1) / fine_size;
+		coarse_x = (img.width() + coarse_size - 1) / coarse_size;
+		int coarse_y = (img.height() + coarse_size - 1) / coarse_size;
+
+		fine.assign(fine_x * fine_y, {clear_depth, clear_depth, false});
+		coarse.assign(coarse_x * coarse_y, {clear_depth, clear_depth, false});
+		counters.resize(coarse.size());
+	}
+
+	// volta ao estado inicial sem alocar memória, para reaproveitar o buffer no próximo quadro
+	void clear(float clear_depth = 1)
+	{
+		std::fill(Z.begin(), Z.end(), clear_depth);
+		std::fill(fine.begin(), fine.end(), DepthTile{clear_depth, clear_depth, false});
+		std::fill(coarse.begin(), coarse.end(), DepthTile{clear_depth, clear_depth, false});
+		std::fill(counters.begin(), counters.end(), HiZStats{});
+	}
+
+	int width() const { return img.width(); }
+	int height() const { return img.height(); }
+
+	RGB &operator()(int x, int y) { return img(x, y); }
+
+	float depth(int x, int y) const { return Z[y * img.width() + x]; }
+
+	// Testa e, se passar, escreve a profundidade z do pixel p.
+	// Com mode == DEPTH_PASS o bloco inteiro já passou e só é preciso escrever.
+	bool testFragment(Pixel p, float z, DepthTest mode)
+	{
+		float &d = Z[p.y * img.width() + p.x];
+		if (mode != DEPTH_PASS)
+		{
+			HiZStats &c = counter(p.x, p.y);
+			c.fragments_tested++;
+			if (!(z < d))
+			{
+				c.fragments_culled++;
+				return false;
+			}
+		}
+		d = z;
+
+		DepthTile &f = fine[(p.y / fine_size) * fine_x + p.x / fine_size];
+		f.zmin = std::min(f.zmin, z);
+		f.dirty = true;
+
+		coarse[(p.y / coarse_size) * coarse_x + p.x / coarse_size].dirty = true;
+		return true;
+	}
+
+	// B é um bloco do rasterizador, contido em um ladrilho de 8x8;
+	// [zmin, zmax] é o intervalo de profundidade do triângulo dentro de B
+	DepthTest testBlock(PixelRect B, float zmin, float zmax)
+	{
+		HiZStats &c = counter(B.x0, B.y0);
+		c.blocks_tested++;
+
+		int fx = B.x0 / fine_size;
+		int fy = B.y0 / fine_size;
+		if (zmin >= fineMax(fx, fy))
+		{
+			c.blocks_culled++;
+			return DEPTH_CULL;
+		}
+		if (zmax < fine[fy * fine_x + fx].zmin)
+		{
+			c.blocks_in_front++;
+			return DEPTH_PASS;
+		}
+		return DEPTH_TEST;
+	}
+
+	// R é o retângulo envolvente do triângulo e zmin sua menor profundidade.
+	// Devolve false se o triângulo está atrás de tudo em todos os ladrilhos que toca.
+	bool testTriangle(PixelRect R, float zmin)
+	{
+		if (R.x0 >= R.x1 || R.y0 >= R.y1)
+			return false;
+
+		HiZStats &c = counter(R.x0, R.y0);
+		c.triangles_tested++;
+
+		for (int cy = R.y0 / coarse_size; cy <= (R.y1 - 1) / coarse_size; cy++)
+			for (int cx = R.x0 / coarse_size; cx <= (R.x1 - 1) / coarse_size; cx++)
+			{
+				if (zmin >= coarseMax(cx, cy))
+					continue;
+
+				// desce para os ladrilhos de 8x8 dentro de R
+				int fx0 = std::max(R.x0, cx * coarse_size) / fine_size;
+				int fy0 = std::max(R.y0, cy * coarse_size) / fine_size;
+				int fx1 = (std::min(R.x1, (cx + 1) * coarse_size) - 1) / fine_size;
+				int fy1 = (std::min(R.y1, (cy + 1) * coarse_size) - 1) / fine_size;
+				for (int fy = fy0; fy <= fy1; fy++)
+					for (int fx = fx0; fx <= fx1; fx++)
+						if (zmin < fineMax(fx, fy))
+							return true;
+			}
+
+		c.triangles_culled++;
+		return false;
+	}
+
+	HiZStats stats() const
+	{
+		HiZStats s;
+		for (const HiZStats &c : counters)
+			s += c;
+		return s;
+	}
+
+private:
+	HiZStats &counter(int x, int y)
+	{
+		return counters[(y / coarse_size) * coarse_x + x / coarse_size];
+	}
+
+	float fineMax(int fx, int fy)
+	{
+		DepthTile &f = fine[fy * fine_x + fx];
+		if (f.dirty)
+		{
+			int x0 = fx * fine_size, x1 = std::min(x0 + fine_size, img.width());
+			int y0 = fy * fine_size, y1 = std::min(y0 + fine_size, img.height());
+			float zmax = -INFINITY;
+			for (int y = y0; y < y1; y++)
+				for (int x = x0; x < x1; x++)
+					zmax = std::max(zmax, Z[y * img.width() + x]);
+			f.zmax = zmax;
+			f.dirty = false;
+		}
+		return f.zmax;
+	}
+
+	float coarseMax(int cx, int cy)
+	{
+		DepthTile &g = coarse[cy * coarse_x + cx];
+		if (g.dirty)
+		{
+			int n = coarse_size / fine_size;
+			int fx1 = std::min((cx + 1) * n, fine_x);
+			int fy1 = std::min((cy + 1) * n, (int)fine.size() / fine_x);
+			float zmax = -INFINITY;
+			for (int fy = cy * n; fy < fy1; fy++)
+				for (int fx = cx * n; fx < fx1; fx++)
+					zmax = std::max(zmax, fineMax(fx, fy));
+			g.zmax = zmax;
+			g.dirty = false;
+		}
+		return g.zmax;
+	}
+};
+
+// Teste antecipado: descarta o que está atrás do ZBuffer hierárquico
+inline bool earlyTriangleTest(ImageHiZBuffer &img, PixelRect R, float zmin)
+{
+	return img.testTriangle(R, zmin);
+}
+
+inline DepthTest earlyBlockTest(ImageHiZBuffer &img, PixelRect B, float zmin, float zmax)
+{
+	return img.testBlock(B, zmin, zmax);
+}
+
+inline bool earlyDepthTest(ImageHiZBuffer &img, Pixel p, float z, DepthTest mode)
+{
+	return img.testFragment(p, z, mode);
+}
+
+template <class Varying>
+bool testPixel(Pixel p, Varying, ImageHiZBuffer &img)
+{
+	return p.x >= 0 && p.y >= 0 && p.x < img.width() && p.y < img.height();
+}
@@ -0,0 +1,298 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+#include "vec.h"
+
+// Metaball de raio de influência b: vale a no centro e 0 a partir da distância b
+struct Metaball
+{
+	float a;
+	float b;
+	vec3 center;
+
+	float operator()(vec3 P) const
+	{
+		vec3 d = P - center;
+		return value(dot(d, d));
+	}
+
+	// valor em função do quadrado da distância ao centro
+	float value(float r2) const
+	{
+		float b2 = b * b;
+		if (r2 >= b2)
+			return 0;
+		if (9 * r2 < b2)
+			return a - 3 * a / b2 * r2;
+		float u = 1 - sqrtf(r2) * (1 / b);
+		return 1.5f * a * (u * u);
+	}
+};
+
+// Campo implícito T - soma dos metaballs (a superfície é o nível 0).
+// Os metaballs são distribuídos em uma grade uniforme pelo seu raio de influência,
+// e cada ponto só soma os metaballs da sua célula da grade.
+class MetaballField
+{
+public:
+	float T;
+
+private:
+	std::vector<Metaball> metaballs;
+
+	vec3 origin = {0, 0, 0};
+	float h = 1;		  // lado da célula da grade
+	int dims[3] = {0, 0, 0};
+	std::vector<unsigned int> first; // metaballs da célula c: ids[first[c]], ..., ids[first[c+1]-1]
+	std::vector<unsigned int> ids;
+
+public:
+	MetaballField(float T = 0, std::vector<Metaball> metaballs = {}) : T{T}
+	{
+		setMetaballs(std::move(metaballs));
+	}
+
+	const std::vector<Metaball> &getMetaballs() const { return metaballs; }
+
+	void setMetaballs(std::vector<Metaball> balls)
+	{
+		metaballs = std::move(balls);
+		first.assign(1, 0);
+		ids.clear();
+		dims[0] = dims[1] = dims[2] = 0;
+		if (metaballs.empty())
+			return;
+
+		vec3 lo = metaballs[0].center, hi = lo;
+		float bsum = 0;
+		for (const Metaball &m : metaballs)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				lo[i] = std::min(lo[i], m.center[i] - m.b);
+				hi[i] = std::max(hi[i], m.center[i] + m.b);
+			}
+			bsum += m.b;
+		}
+
+		// células com o diâmetro médio de influência, no máximo 64 por eixo
+		h = 2 * bsum / metaballs.size();
+		for (int i = 0; i < 3; i++)
+			h = std::max(h, (hi[i] - lo[i]) / 64);
+		origin = lo;
+		for (int i = 0; i < 3; i++)
+			dims[i] = std::max(1, (int)ceil((hi[i] - lo[i]) / h));
+
+		// conta e depois preenche os metaballs de cada célula
+		int ncells = dims[0] * dims[1] * dims[2];
+		first.assign(ncells + 1, 0);
+		for (int pass = 0; pass < 2; pass++)
+		{
+			std::vector<unsigned int> next(first.begin(), first.end() - 1);
+			for (unsigned int id = 0; id < metaballs.size(); id++)
+			{
+				const Metaball &m = metaballs[id];
+				int c0[3], c1[3];
+				cellRange(m.center - vec3{m.b, m.b, m.b}, m.center + vec3{m.b, m.b, m.b}, c0, c1);
+				for (int z = c0[2]; z <= c1[2]; z++)
+					for (int y = c0[1]; y <= c1[1]; y++)
+						for (int x = c0[0]; x <= c1[0]; x++)
+						{
+							int c = (z * dims[1] + y) * dims[0] + x;
+							if (pass == 0)
+								first[c + 1]++;
+							else
+								ids[next[c]++] = id;
+						}
+			}
+			if (pass == 0)
+			{
+				for (int c = 0; c < ncells; c++)
+					first[c + 1] += first[c];
+				ids.resize(first[ncells]);
+			}
+		}
+	}
+
+	float operator()(float x, float y, float z) const
+	{
+		int c = cell({x, y, z});
+		if (c < 0)
+			return T;
+
+		vec3 P = {x, y, z};
+		float sum = 0;
+		for (unsigned int i = first[c]; i < first[c + 1]; i++)
+			sum += metaballs[ids[i]](P);
+		return T - sum;
+	}
+
+	// limites (conservadores) do campo na caixa [lo, hi]:
+	// cada metaball decresce com a distância ao centro
+	std::pair<float, float> range(vec3 lo, vec3 hi) const
+	{
+		std::vector<unsigned int> near_balls;
+		collect(lo, hi, near_balls);
+
+		float smin = 0, smax = 0;
+		for (unsigned int id : near_balls)
+		{
+			const Metaball &m = metaballs[id];
+			vec3 near, far;
+			for (int i = 0; i < 3; i++)
+			{
+				near[i] = std::min(std::max(m.center[i], lo[i]), hi[i]);
+				far[i] = m.center[i] - lo[i] > hi[i] - m.center[i] ? lo[i] : hi[i];
+			}
+			smax += m(near);
+			smin += m(far);
+		}
+		return {T - smax, T - smin};
+	}
+
+	// Campo em uma linha de pontos: out[i] = f(x0 + (first + i)*dx, y, z), i = 0, ..., n-1.
+	// Só os metaballs que alcançam a linha são somados, 8 pontos por vez com AVX.
+	// Cada ponto tem sempre o mesmo valor, qualquer que seja o trecho da linha pedido.
+	void evalRow(float x0, float dx, int first_x, int n, float y, float z, float *out) const
+	{
+		if (n <= 0)
+			return;
+
+		// metaballs das células da linha e o quadrado da distância de cada um à linha
+		thread_local std::vector<unsigned int> row;
+		thread_local std::vector<float> e2;
+
+		float xa = x0 + first_x * dx, xb = x0 + (first_x + n - 1) * dx;
+		collect({std::min(xa, xb), y, z}, {std::max(xa, xb), y, z}, row);
+		e2.resize(row.size());
+		for (unsigned int k = 0; k < row.size(); k++)
+		{
+			const Metaball &m = metaballs[row[k]];
+			e2[k] = (y - m.center[1]) * (y - m.center[1]) + (z - m.center[2]) * (z - m.center[2]);
+		}
+
+		const int S = 64;
+		alignas(32) float xs[S], sum[S];
+		for (int s = 0; s < n; s += S)
+		{
+			int count = std::min(S, n - s);
+			for (int i = 0; i < S; i++)
+			{
+				// calculado em double: o resultado não depende da contração em FMA
+				xs[i] = i < count ? (float)(x0 + (double)(first_x + s + i) * dx) : INFINITY;
+				sum[i] = 0;
+			}
+			float xlo = std::min(xs[0], xs[count - 1]), xhi = std::max(xs[0], xs[count - 1]);
+
+			for (unsigned int k = 0; k < row.size(); k++)
+			{
+				const Metaball &m = metaballs[row[k]];
+				float b2 = m.b * m.b;
+				if (e2[k] >= b2)
+					continue;
+				// com folga: fora do alcance a soma recebe exatamente 0
+				float half = sqrtf(b2 - e2[k]) * 1.001f + fabsf(dx);
+				if (m.center[0] + half < xlo || m.center[0] - half > xhi)
+					continue;
+
+				accumulate(m, e2[k], xs, sum, count);
+			}
+
+			for (int i = 0; i < count; i++)
+				out[s + i] = T - sum[i];
+		}
+	}
+
+private:
+	// soma a m os valores do metaball m nos pontos (xs[i], ...), com distância e2 ao quadrado da linha
+	static void accumulate(const Metaball &m, float e2, const float *xs, float *sum, int count)
+	{
+		float b2 = m.b * m.b;
+		float k_in = 3 * m.a / b2;
+		float inv_b = 1 / m.b;
+		float a_out = 1.5f * m.a;
+		int i = 0;
+#if defined(__AVX__)
+		__m256 cx = _mm256_set1_ps(m.center[0]);
+		__m256 ve2 = _mm256_set1_ps(e2);
+		__m256 vb2 = _mm256_set1_ps(b2);
+		__m256 vb2_9 = _mm256_set1_ps(b2 / 9);
+		__m256 va = _mm256_set1_ps(m.a);
+		__m256 vk_in = _mm256_set1_ps(k_in);
+		__m256 vinv_b = _mm256_set1_ps(inv_b);
+		__m256 va_out = _mm256_set1_ps(a_out);
+		__m256 one = _mm256_set1_ps(1);
+		for (; i < count; i += 8)
+		{
+			__m256 d = _mm256_sub_ps(_mm256_load_ps(xs + i), cx);
+			__m256 r2 = _mm256_add_ps(_mm256_mul_ps(d, d), ve2);
+
+			__m256 v_in = _mm256_sub_ps(va, _mm256_mul_ps(vk_in, r2));
+			__m256 u = _mm256_sub_ps(one, _mm256_mul_ps(_mm256_sqrt_ps(r2), vinv_b));
+			__m256 v_out = _mm256_mul_ps(va_out, _mm256_mul_ps(u, u));
+
+			__m256 v = _mm256_blendv_ps(v_out, v_in, _mm256_cmp_ps(r2, vb2_9, _CMP_LT_OQ));
+			v = _mm256_and_ps(v, _mm256_cmp_ps(r2, vb2, _CMP_LT_OQ));
+			_mm256_store_ps(sum + i, _mm256_add_ps(_mm256_load_ps(sum + i), v));
+		}
+#else
+		for (; i < count; i++)
+		{
+			float d = xs[i] - m.center[0];
+			float r2 = d * d + e2;
+			float u = 1 - sqrtf(r2) * inv_b;
+			float v = r2 < b2 / 9 ? m.a - k_in * r2 : a_out * (u * u);
+			sum[i] += r2 < b2 ? v : 0;
+		}
+#endif
+	}
+
+	// células da grade que cobrem a caixa [lo, hi], limitadas à grade
+	void cellRange(vec3 lo, vec3 hi, int c0[3], int c1[3]) const
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			c0[i] = std::max(0, (int)floor((lo[i] - origin[i]) / h));
+			c1[i] = std::min(dims[i] - 1, (int)floor((hi[i] - origin[i]) / h));
+		}
+	}
+
+	int cell(vec3 P) const
+	{
+		int c[3];
+		for (int i = 0; i < 3; i++)
+		{
+			float t = (P[i] - origin[i]) / h;
+			if (!(t >= 0 && t < dims[i]))
+				return -1;
+			c[i] = std::min((int)t, dims[i] - 1);
+		}
+		return (c[2] * dims[1] + c[1]) * dims[0] + c[0];
+	}
+
+	// metaballs das células que cobrem a caixa [lo, hi], sem repetição e em ordem
+	void collect(vec3 lo, vec3 hi, std::vector<unsigned int> &result) const
+	{
+		result.clear();
+		if (metaballs.empty())
+			return;
+
+		int c0[3], c1[3];
+		cellRange(lo, hi, c0, c1);
+		for (int z = c0[2]; z <= c1[2]; z++)
+			for (int y = c0[1]; y <= c1[1]; y++)
+				for (int x = c0[0]; x <= c1[0]; x++)
+				{
+					int c = (z * dims[1] + y) * dims[0] + x;
+					result.insert(result.end(), ids.begin() + first[c], ids.begin() + first[c + 1]);
+				}
+		std::sort(result.begin(), result.end());
+		result.erase(std::unique(result.begin(), result.end()), result.end());
+	}
+};
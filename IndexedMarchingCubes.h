@@ -0,0 +1,402 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cmath>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "vec.h"
+#include "ThreadPool.h"
+
+// Malha indexada: os vértices compartilhados por vários triângulos aparecem uma única vez
+struct IndexedMesh
+{
+	std::vector<vec3> vertices;
+	std::vector<unsigned int> indices; // 3 por triângulo
+};
+
+// Tabela de triangulação do marching cubes.
+// O canto c do cubo fica em (c & 1, c >> 1 & 1, c >> 2 & 1); o caso de um cubo tem o bit c
+// ligado quando o canto c está dentro da superfície (campo negativo).
+// A tabela é gerada percorrendo o contorno da superfície em cada face do cubo: nas faces
+// ambíguas os cantos internos ficam separados, como nos cubos vizinhos, e a malha é fechada.
+// Os triângulos ficam em sentido anti-horário vistos de fora (do lado positivo do campo).
+struct MarchingCubesCases
+{
+	// a aresta e vai do canto edge_corner[e] ao longo do eixo edge_axis[e]
+	int edge_corner[12];
+	int edge_axis[12];
+
+	// arestas dos triângulos de cada caso
+	std::vector<std::array<int, 3>> triangles[256];
+
+	MarchingCubesCases()
+	{
+		int edge[8][8];
+		int ne = 0;
+		for (int axis = 0; axis < 3; axis++)
+			for (int c = 0; c < 8; c++)
+				if (!(c >> axis & 1))
+				{
+					edge_corner[ne] = c;
+					edge_axis[ne] = axis;
+					edge[c][c | 1 << axis] = edge[c | 1 << axis][c] = ne;
+					ne++;
+				}
+
+		// cantos de cada face, em sentido anti-horário vistos de fora do cubo
+		const int faces[6][4] = {
+			{0, 4, 6, 2}, {1, 3, 7, 5}, {0, 1, 5, 4}, {2, 6, 7, 3}, {0, 2, 3, 1}, {4, 5, 7, 6}};
+
+		for (int m = 0; m < 256; m++)
+		{
+			auto inside = [m](int c) { return (m >> c & 1) != 0; };
+
+			// next[e]: aresta seguinte no contorno da superfície
+			int next[12];
+			std::fill(next, next + 12, -1);
+			for (const auto &f : faces)
+				for (int i = 0; i < 4; i++)
+				{
+					// o contorno sai da região interna pela aresta i...
+					if (!inside(f[i]) || inside(f[(i + 1) % 4]))
+						continue;
+
+					// ... e volta para a aresta por onde entrou nela
+					int j = (i + 3) % 4;
+					while (!(inside(f[(j + 1) % 4]) && !inside(f[j])))
+						j = (j + 3) % 4;
+
+					next[edge[f[i]][f[(i + 1) % 4]]] = edge[f[j]][f[(j + 1) % 4]];
+				}
+
+			bool visited[12] = {};
+			for (int e = 0; e < 12; e++)
+			{
+				if (next[e] < 0 || visited[e])
+					continue;
+
+				std::vector<int> loop;
+				for (int k = e; !visited[k]; k = next[k])
+				{
+					visited[k] = true;
+					loop.push_back(k);
+				}
+
+				// Triangula em leque a partir de um vértice do contorno que não gere triângulos
+				// contidos em uma face do cubo: esses coincidiriam com os do cubo vizinho.
+				unsigned int n = loop.size(), apex = 0;
+				for (unsigned int a = 0; a < n; a++)
+				{
+					bool flat = false;
+					for (unsigned int i = 1; i + 1 < n; i++)
+						flat |= sameFace(faces, loop[a], loop[(a + i) % n], loop[(a + i + 1) % n]);
+					if (!flat)
+					{
+						apex = a;
+						break;
+					}
+				}
+				for (unsigned int i = 1; i + 1 < n; i++)
+					triangles[m].push_back({loop[apex], loop[(apex + i + 1) % n], loop[(apex + i) % n]});
+			}
+		}
+	}
+
+private:
+	// verdadeiro se as arestas e0, e1 e e2 estão na mesma face do cubo
+	bool sameFace(const int faces[6][4], int e0, int e1, int e2) const
+	{
+		for (int f = 0; f < 6; f++)
+		{
+			int count = 0;
+			for (int e : {e0, e1, e2})
+			{
+				int a = edge_corner[e], b = a | 1 << edge_axis[e];
+				bool has_a = false, has_b = false;
+				for (int i = 0; i < 4; i++)
+				{
+					has_a |= faces[f][i] == a;
+					has_b |= faces[f][i] == b;
+				}
+				count += has_a && has_b;
+			}
+			if (count == 3)
+				return true;
+		}
+		return false;
+	}
+};
+
+inline const MarchingCubesCases &marchingCubesCases()
+{
+	static MarchingCubesCases cases;
+	return cases;
+}
+
+// Campos que sabem limitar seus valores dentro de uma caixa:
+// f.range(lo, hi) devolve {min, max} (conservadores) do campo em [lo, hi]
+template <class F, class = void>
+struct has_field_range : std::false_type
+{
+};
+
+template <class F>
+struct has_field_range<F, std::void_t<decltype(std::declval<F &>().range(vec3{}, vec3{}))>>
+	: std::true_type
+{
+};
+
+// Campos que calculam uma linha de pontos de uma vez (ver MetaballField, em ImplicitField.h)
+template <class F, class = void>
+struct has_eval_row : std::false_type
+{
+};
+
+template <class F>
+struct has_eval_row<F, std::void_t<decltype(std::declval<F &>().evalRow(0.0f, 0.0f, 0, 0, 0.0f, 0.0f, (float *)nullptr))>>
+	: std::true_type
+{
+};
+
+// out[i] = f(x0 + (first + i)*dx, y, z), i = 0, ..., n-1
+template <class F>
+void evalRow(F &f, float x0, float dx, int first, int n, float y, float z, float *out)
+{
+	if constexpr (has_eval_row<F>::value)
+		f.evalRow(x0, dx, first, n, y, z, out);
+	else
+		for (int i = 0; i < n; i++)
+			out[i] = f(x0 + (first + i) * dx, y, z);
+}
+
+// Marching cubes em paralelo, com saída indexada.
+// A grade tem nx*ny*nz células em [pmin, pmax] e a superfície é f(x, y, z) = 0.
+// - O campo é calculado uma vez por ponto em fatias (planos z) reaproveitadas entre
+//   camadas de células; cada camada de blocos de 8 células é processada por uma thread.
+// - Cada aresta da grade gera no máximo um vértice, compartilhado pelas células vizinhas.
+// - Se o campo tem range(lo, hi), uma octree de mínimos/máximos descarta os blocos
+//   de 8x8x8 células em que o campo não muda de sinal, sem calculá-lo.
+template <class F>
+IndexedMesh marchingCubesIndexed(F f, int nx, int ny, int nz, vec3 pmin, vec3 pmax,
+								 ThreadPool &pool = defaultThreadPool())
+{
+	const MarchingCubesCases &cases = marchingCubesCases();
+	const int B = 8; // lado do bloco da octree, em células
+
+	IndexedMesh mesh;
+	if (nx <= 0 || ny <= 0 || nz <= 0)
+		return mesh;
+
+	vec3 d = {(pmax[0] - pmin[0]) / nx, (pmax[1] - pmin[1]) / ny, (pmax[2] - pmin[2]) / nz};
+	auto point = [&](int i, int j, int k) -> vec3
+	{
+		return {pmin[0] + i * d[0], pmin[1] + j * d[1], pmin[2] + k * d[2]};
+	};
+
+	// blocos ativos: os que a octree não pôde descartar
+	int bx = (nx + B - 1) / B, by = (ny + B - 1) / B, bz = (nz + B - 1) / B;
+	std::vector<char> active(bx * by * bz, 1);
+	if constexpr (has_field_range<F>::value)
+	{
+		std::fill(active.begin(), active.end(), 0);
+
+		// visita a caixa de blocos [b0, b1), subdividindo-a enquanto o campo puder mudar de sinal
+		auto visit = [&](auto &self, std::array<int, 3> b0, std::array<int, 3> b1) -> void
+		{
+			vec3 lo = point(b0[0] * B, b0[1] * B, b0[2] * B);
+			vec3 hi = point(std::min(b1[0] * B, nx), std::min(b1[1] * B, ny), std::min(b1[2] * B, nz));
+			auto [fmin, fmax] = f.range(lo, hi);
+			if (fmin > 0 || fmax < 0)
+				return;
+
+			if (b1[0] - b0[0] == 1 && b1[1] - b0[1] == 1 && b1[2] - b0[2] == 1)
+			{
+				active[(b0[2] * by + b0[1]) * bx + b0[0]] = 1;
+				return;
+			}
+
+			std::array<int, 3> mid;
+			for (int a = 0; a < 3; a++)
+				mid[a] = (b0[a] + b1[a] + 1) / 2;
+
+			for (int o = 0; o < 8; o++)
+			{
+				std::array<int, 3> c0, c1;
+				for (int a = 0; a < 3; a++)
+				{
+					c0[a] = o >> a & 1 ? mid[a] : b0[a];
+					c1[a] = o >> a & 1 ? b1[a] : mid[a];
+				}
+				if (c0[0] < c1[0] && c0[1] < c1[1] && c0[2] < c1[2])
+					self(self, c0, c1);
+			}
+		};
+		visit(visit, {0, 0, 0}, {bx, by, bz});
+	}
+
+	// Vértices criados por uma camada de blocos. As arestas x e y dos planos de baixo e
+	// de cima também são criadas pelas camadas vizinhas; ficam registradas para a junção.
+	int px = nx + 1, py = ny + 1; // pontos por linha e por coluna do plano
+
+	struct Chunk
+	{
+		std::vector<vec3> vertices;
+		std::vector<unsigned int> indices;
+		std::vector<std::pair<unsigned int, int>> bottom, top; // (aresta no plano, vértice)
+	};
+	std::vector<Chunk> chunks(bz);
+
+	pool.parallel_for(bz, [&](unsigned int c)
+	{
+		Chunk &chunk = chunks[c];
+		int k0 = c * B, k1 = std::min(k0 + B, nz);
+
+		// linhas de pontos usadas pelos blocos ativos desta camada: [lo[j], hi[j])
+		std::vector<int> lo(py, px), hi(py, 0);
+		bool any = false;
+		for (int j = 0; j < by; j++)
+			for (int i = 0; i < bx; i++)
+				if (active[(c * by + j) * bx + i])
+				{
+					any = true;
+					for (int y = j * B; y <= std::min((j + 1) * B, ny); y++)
+					{
+						lo[y] = std::min(lo[y], i * B);
+						hi[y] = std::max(hi[y], std::min((i + 1) * B, nx) + 1);
+					}
+				}
+		if (!any)
+			return;
+
+		std::vector<float> values[2] = {std::vector<float>(px * py), std::vector<float>(px * py)};
+		auto evalPlane = [&](std::vector<float> &V, int k)
+		{
+			for (int j = 0; j < py; j++)
+				if (lo[j] < hi[j])
+				{
+					vec3 p = point(0, j, k);
+					evalRow(f, p[0], d[0], lo[j], hi[j] - lo[j], p[1], p[2], &V[j * px + lo[j]]);
+				}
+		};
+
+		// índices dos vértices das arestas x e y dos planos k e k+1 e das arestas z entre eles
+		std::vector<int> edges_x[2], edges_y[2], edges_z;
+		for (int s = 0; s < 2; s++)
+		{
+			edges_x[s].assign(px * py, -1);
+			edges_y[s].assign(px * py, -1);
+		}
+		edges_z.assign(px * py, -1);
+
+		evalPlane(values[0], k0);
+		for (int k = k0; k < k1; k++)
+		{
+			evalPlane(values[1], k + 1);
+
+			for (int j = 0; j < by; j++)
+				for (int i = 0; i < bx; i++)
+				{
+					if (!active[(c * by + j) * bx + i])
+						continue;
+
+					for (int y = j * B; y < std::min((j + 1) * B, ny); y++)
+						for (int x = i * B; x < std::min((i + 1) * B, nx); x++)
+						{
+							float v[8];
+							int m = 0;
+							for (int corner = 0; corner < 8; corner++)
+							{
+								int slot = (y + (corner >> 1 & 1)) * px + x + (corner & 1);
+								v[corner] = values[corner >> 2][slot];
+								m |= (v[corner] < 0) << corner;
+							}
+							if (m == 0 || m == 255)
+								continue;
+
+							auto vertex = [&](int e) -> unsigned int
+							{
+								int corner = cases.edge_corner[e];
+								int axis = cases.edge_axis[e];
+								int s = corner >> 2;
+								int slot = (y + (corner >> 1 & 1)) * px + x + (corner & 1);
+
+								int &id = axis == 0 ? edges_x[s][slot] : axis == 1 ? edges_y[s][slot] : edges_z[slot];
+								if (id < 0)
+								{
+									int other = corner | 1 << axis;
+									float a = v[corner], b = v[other];
+									float t = a / (a - b);
+									vec3 P = point(x + (corner & 1), y + (corner >> 1 & 1), k + s);
+									P[axis] += t * d[axis];
+
+									id = chunk.vertices.size();
+									chunk.vertices.push_back(P);
+								}
+								return id;
+							};
+
+							for (const auto &tri : cases.triangles[m])
+								for (int e : tri)
+									chunk.indices.push_back(vertex(e));
+						}
+				}
+
+			// arestas dos planos compartilhados com as camadas vizinhas
+			auto save = [&](std::vector<std::pair<unsigned int, int>> &plane, int s)
+			{
+				for (int slot = 0; slot < px * py; slot++)
+				{
+					if (edges_x[s][slot] >= 0)
+						plane.push_back({slot, edges_x[s][slot]});
+					if (edges_y[s][slot] >= 0)
+						plane.push_back({px * py + slot, edges_y[s][slot]});
+				}
+			};
+			if (k == k0)
+				save(chunk.bottom, 0);
+			if (k + 1 == k1)
+				save(chunk.top, 1);
+
+			// o plano de cima passa a ser o de baixo
+			std::swap(values[0], values[1]);
+			std::swap(edges_x[0], edges_x[1]);
+			std::swap(edges_y[0], edges_y[1]);
+			std::fill(edges_x[1].begin(), edges_x[1].end(), -1);
+			std::fill(edges_y[1].begin(), edges_y[1].end(), -1);
+			std::fill(edges_z.begin(), edges_z.end(), -1);
+		}
+	});
+
+	// Junta as camadas. Os vértices das arestas do plano entre duas camadas
+	// foram criados pelas duas; fica o da camada de baixo.
+	std::vector<int> shared(2 * px * py, -1); // índice final dos vértices do topo da camada anterior
+	std::vector<unsigned int> remap;
+	for (int c = 0; c < bz; c++)
+	{
+		Chunk &chunk = chunks[c];
+
+		remap.assign(chunk.vertices.size(), UINT_MAX);
+		for (auto [edge, id] : chunk.bottom)
+			if (shared[edge] >= 0)
+				remap[id] = shared[edge];
+		std::fill(shared.begin(), shared.end(), -1);
+
+		for (unsigned int id = 0; id < chunk.vertices.size(); id++)
+			if (remap[id] == UINT_MAX)
+			{
+				remap[id] = mesh.vertices.size();
+				mesh.vertices.push_back(chunk.vertices[id]);
+			}
+
+		for (unsigned int id : chunk.indices)
+			mesh.indices.push_back(remap[id]);
+		for (auto [edge, id] : chunk.top)
+			shared[edge] = remap[id];
+
+		chunk = Chunk{};
+	}
+	return mesh;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Arquivo mapeado na memória, só para leitura.
+// Também pode guardar um buffer em memória, com a mesma interface.
+class MappedFile
+{
+	const char *ptr = nullptr;
+	size_t length = 0;
+	bool mapped = false;
+	std::vector<char> buffer;
+
+public:
+	MappedFile() = default;
+
+	explicit MappedFile(std::vector<char> bytes) : buffer{std::move(bytes)}
+	{
+		ptr = buffer.data();
+		length = buffer.size();
+	}
+
+	// arquivo vazio (data() == nullptr) se não puder ser aberto
+	explicit MappedFile(const std::string &file)
+	{
+#if defined(_WIN32)
+		// sem mmap: o arquivo é lido
+		std::ifstream in{file, std::ios::binary};
+		if (in)
+			*this = MappedFile{std::vector<char>{std::istreambuf_iterator<char>{in}, {}}};
+#else
+		int fd = ::open(file.c_str(), O_RDONLY);
+		if (fd < 0)
+			return;
+
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0)
+		{
+			void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p != MAP_FAILED)
+			{
+				ptr = static_cast<const char *>(p);
+				length = st.st_size;
+				mapped = true;
+			}
+		}
+		::close(fd);
+#endif
+	}
+
+	MappedFile(MappedFile &&other) noexcept { *this = std::move(other); }
+
+	MappedFile &operator=(MappedFile &&other) noexcept
+	{
+		if (this != &other)
+		{
+			unmap();
+			ptr = other.ptr;
+			length = other.length;
+			mapped = other.mapped;
+			buffer = std::move(other.buffer);
+			other.ptr = nullptr;
+			other.length = 0;
+			other.mapped = false;
+		}
+		return *this;
+	}
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	~MappedFile() { unmap(); }
+
+	const char *data() const { return ptr; }
+	size_t size() const { return length; }
+
+private:
+	void unmap()
+	{
+#if !defined(_WIN32)
+		if (mapped)
+			munmap(const_cast<char *>(ptr), length);
+#endif
+		mapped = false;
+	}
+};
+
+// Vetor só para leitura sobre memória de outro objeto (por exemplo, um MappedFile)
+template <class T>
+struct ArrayView
+{
+	const T *ptr = nullptr;
+	size_t n = 0;
+
+	size_t size() const { return n; }
+	const T *data() const { return ptr; }
+	const T &operator[](size_t i) const { return ptr[i]; }
+	const T *begin() const { return ptr; }
+	const T *end() const { return ptr + n; }
+};
+
+// hash FNV-1a, 8 bytes por vez
+inline uint64_t hashBytes(const char *data, size_t n)
+{
+	uint64_t h = 14695981039346656037ull;
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		uint64_t w;
+		memcpy(&w, data + i, 8);
+		h = (h ^ w) * 1099511628211ull;
+	}
+	for (; i < n; i++)
+		h = (h ^ (unsigned char)data[i]) * 1099511628211ull;
+	return h;
+}
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "MappedFile.h"
+#include "ClusterBVH.h"
+#include "ObjMesh.h"
+#include "ObjParser.h"
+
+// Malha de um arquivo OBJ guardada em um arquivo binário (por padrão obj_file + ".cache"),
+// gerado na primeira carga e depois só mapeado na memória: os vértices não são copiados.
+// O cache é refeito quando o tamanho do OBJ muda, ou quando a data de modificação muda e o conteúdo também.
+// Dos materiais são guardados os campos usados pelos programas: Kd e map_Kd.
+// Os triângulos de cada material são reordenados em clusters, com uma BVH por material
+// (ClusterBVH.h) gravada junto, para o descarte de clusters fora da tela ou de costas.
+class CachedObjMesh
+{
+	static_assert(std::is_trivially_copyable<ObjMesh::Vertex>::value, "os vértices são gravados byte a byte");
+	static_assert(std::is_trivially_copyable<Cluster>::value && std::is_trivially_copyable<BVHNode>::value,
+				  "a BVH é gravada byte a byte");
+
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t vertex_size;
+		int64_t mtime;
+		uint64_t obj_size;
+		uint64_t hash;
+		uint64_t vertex_count, vertices; // vértices: posição no arquivo e quantidade
+		uint64_t range_count, ranges;
+		uint64_t strings_size, strings;
+		uint64_t node_count, nodes;
+		uint64_t cluster_count, clusters;
+	};
+
+	struct Range
+	{
+		uint32_t first, count;
+		uint32_t default_material; // faixa sem material: usa o std_mat de getMaterials
+		float Kd[3];
+		uint64_t map_Kd, map_Kd_size; // posição e tamanho em strings
+		uint32_t bvh_root;
+	};
+
+	static constexpr char magic[8] = {'O', 'B', 'J', 'C', 'A', 'C', 'H', 'E'};
+	static constexpr uint32_t version = 2;
+
+	MappedFile file;
+
+public:
+	std::string path;		 // diretório do OBJ, como em ObjMesh
+	bool rebuilt = false;	 // o cache foi gerado a partir do OBJ nesta carga
+	bool rehashed = false;	 // a data do OBJ mudou e o conteúdo foi conferido
+
+	explicit CachedObjMesh(const std::string &obj_file) : CachedObjMesh{obj_file, obj_file + ".cache"} {}
+
+	CachedObjMesh(const std::string &obj_file, const std::string &cache_file)
+	{
+		size_t slash = obj_file.find_last_of("/\\");
+		path = slash == std::string::npos ? "" : obj_file.substr(0, slash + 1);
+
+		file = MappedFile{cache_file};
+		if (valid(obj_file, cache_file))
+			return;
+
+		std::vector<char> bytes = build(obj_file);
+		rebuilt = true;
+
+		// grava em um arquivo temporário e troca: nunca fica um cache pela metade
+		std::string tmp = cache_file + ".tmp";
+		std::ofstream out{tmp, std::ios::binary};
+		out.write(bytes.data(), bytes.size());
+		out.close();
+		std::error_code error;
+		if (out)
+			std::filesystem::rename(tmp, cache_file, error);
+		else
+			std::filesystem::remove(tmp, error);
+
+		file = MappedFile{cache_file};
+		if (!structurallyValid())
+			file = MappedFile{std::move(bytes)}; // sem permissão de escrita: usa a cópia em memória
+	}
+
+	ArrayView<ObjMesh::Vertex> getTriangles() const
+	{
+		const Header &h = header();
+		return {reinterpret_cast<const ObjMesh::Vertex *>(file.data() + h.vertices), h.vertex_count};
+	}
+
+	ArrayView<BVHNode> getBVHNodes() const
+	{
+		const Header &h = header();
+		return {reinterpret_cast<const BVHNode *>(file.data() + h.nodes), h.node_count};
+	}
+
+	ArrayView<Cluster> getClusters() const
+	{
+		const Header &h = header();
+		return {reinterpret_cast<const Cluster *>(file.data() + h.clusters), h.cluster_count};
+	}
+
+	// raiz da BVH de cada faixa de getMaterials, na mesma ordem
+	std::vector<unsigned int> getBVHRoots() const
+	{
+		const Header &h = header();
+		const Range *R = reinterpret_cast<const Range *>(file.data() + h.ranges);
+		std::vector<unsigned int> roots;
+		for (uint64_t i = 0; i < h.range_count; i++)
+			roots.push_back(R[i].bvh_root);
+		return roots;
+	}
+
+	std::vector<MaterialRange> getMaterials(MaterialInfo std_mat) const
+	{
+		const Header &h = header();
+		const Range *R = reinterpret_cast<const Range *>(file.data() + h.ranges);
+		std::vector<MaterialRange> result;
+		for (uint64_t i = 0; i < h.range_count; i++)
+		{
+			MaterialRange range;
+			range.mat = std_mat;
+			if (!R[i].default_material)
+			{
+				range.mat = MaterialInfo{};
+				range.mat.Kd = {R[i].Kd[0], R[i].Kd[1], R[i].Kd[2]};
+				range.mat.map_Kd.assign(file.data() + h.strings + R[i].map_Kd, R[i].map_Kd_size);
+			}
+			range.first = R[i].first;
+			range.count = R[i].count;
+			result.push_back(range);
+		}
+		return result;
+	}
+
+private:
+	const Header &header() const { return *reinterpret_cast<const Header *>(file.data()); }
+
+	static void stat(const std::string &obj_file, int64_t &mtime, uint64_t &size)
+	{
+		std::error_code error;
+		mtime = std::filesystem::last_write_time(obj_file, error).time_since_epoch().count();
+		size = std::filesystem::file_size(obj_file, error);
+		if (error)
+			size = UINT64_MAX;
+	}
+
+	bool structurallyValid() const
+	{
+		if (file.size() < sizeof(Header))
+			return false;
+
+		const Header &h = header();
+		return memcmp(h.magic, magic, sizeof(magic)) == 0 && h.version == version &&
+			   h.vertex_size == sizeof(ObjMesh::Vertex) &&
+			   h.vertices + h.vertex_count * sizeof(ObjMesh::Vertex) <= file.size() &&
+			   h.ranges + h.range_count * sizeof(Range) <= file.size() &&
+			   h.strings + h.strings_size <= file.size() &&
+			   h.nodes + h.node_count * sizeof(BVHNode) <= file.size() &&
+			   h.clusters + h.cluster_count * sizeof(Cluster) <= file.size();
+	}
+
+	bool valid(const std::string &obj_file, const std::string &cache_file)
+	{
+		if (!structurallyValid())
+			return false;
+
+		int64_t mtime;
+		uint64_t size;
+		stat(obj_file, mtime, size);
+		const Header &h = header();
+		if (size == UINT64_MAX) // sem o OBJ, vale o cache
+			return true;
+		if (size != h.obj_size)
+			return false;
+		if (mtime == h.mtime)
+			return true;
+
+		// só a data mudou: confere o conteúdo e, se for o mesmo, atualiza a data no cache
+		MappedFile obj{obj_file};
+		rehashed = true;
+		if (hashBytes(obj.data(), obj.size()) != h.hash)
+			return false;
+
+		if (FILE *f = fopen(cache_file.c_str(), "r+b"))
+		{
+			fseek(f, offsetof(Header, mtime), SEEK_SET);
+			fwrite(&mtime, sizeof(mtime), 1, f);
+			fclose(f);
+		}
+		return true;
+	}
+
+	static std::vector<char> build(const std::string &obj_file)
+	{
+		ParallelObjMesh mesh{obj_file};
+		std::vector<ObjMesh::Vertex> tris = mesh.getTriangles();
+
+		// um std_mat impossível em um OBJ identifica as faixas sem material
+		MaterialInfo marker;
+		marker.map_Kd = std::string(1, '\0') + "default";
+		std::vector<MaterialRange> materials = mesh.getMaterials(marker);
+
+		Header h{};
+		memcpy(h.magic, magic, sizeof(magic));
+		h.version = version;
+		h.vertex_size = sizeof(ObjMesh::Vertex);
+		stat(obj_file, h.mtime, h.obj_size);
+		{
+			MappedFile obj{obj_file};
+			h.hash = hashBytes(obj.data(), obj.size());
+		}
+
+		auto align = [](uint64_t offset) { return (offset + 63) & ~uint64_t{63}; };
+		h.vertex_count = tris.size();
+		h.vertices = align(sizeof(Header));
+		h.range_count = materials.size();
+		h.ranges = align(h.vertices + tris.size() * sizeof(ObjMesh::Vertex));
+
+		std::string strings;
+		std::vector<Range> ranges;
+		std::vector<BVHNode> nodes;
+		std::vector<Cluster> clusters;
+		for (const MaterialRange &m : materials)
+		{
+			Range r{};
+			r.first = m.first;
+			r.count = m.count;
+			r.bvh_root = buildClusterBVH(tris.data(), m.first, m.count, nodes, clusters);
+			r.default_material = m.mat.map_Kd == marker.map_Kd;
+			for (int k = 0; k < 3; k++)
+				r.Kd[k] = m.mat.Kd[k];
+			if (!r.default_material)
+			{
+				r.map_Kd = strings.size();
+				r.map_Kd_size = m.mat.map_Kd.size();
+				strings += m.mat.map_Kd;
+			}
+			ranges.push_back(r);
+		}
+		h.strings = h.ranges + ranges.size() * sizeof(Range);
+		h.strings_size = strings.size();
+		h.node_count = nodes.size();
+		h.nodes = align(h.strings + strings.size());
+		h.cluster_count = clusters.size();
+		h.clusters = align(h.nodes + nodes.size() * sizeof(BVHNode));
+
+		std::vector<char> bytes(h.clusters + clusters.size() * sizeof(Cluster), 0);
+		memcpy(bytes.data(), &h, sizeof(h));
+		if (!tris.empty())
+			memcpy(bytes.data() + h.vertices, tris.data(), tris.size() * sizeof(ObjMesh::Vertex));
+		if (!ranges.empty())
+			memcpy(bytes.data() + h.ranges, ranges.data(), ranges.size() * sizeof(Range));
+		memcpy(bytes.data() + h.strings, strings.data(), strings.size());
+		if (!nodes.empty())
+			memcpy(bytes.data() + h.nodes, nodes.data(), nodes.size() * sizeof(BVHNode));
+		if (!clusters.empty())
+			memcpy(bytes.data() + h.clusters, clusters.data(), clusters.size() * sizeof(Cluster));
+		return bytes;
+	}
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+#include "Image.h"
+#include "rasterization.h"
+
+// Imagem com várias amostras por pixel (MSAA), como o framebuffer pedido com GLFW_SAMPLES.
+// Cada amostra tem sua cor e sua profundidade. O Render3D e o Render2D rasterizam os triângulos
+// com máscaras de cobertura (rasterizeTriangleSamples), testam a profundidade de cada amostra e
+// rodam o fragmentShader uma vez por pixel, copiando a cor para as amostras cobertas que passaram.
+// O custo de sombreamento é o mesmo de uma amostra; só as bordas ficam com amostras diferentes.
+// resolve() escreve a média das amostras de cada pixel na imagem de destino.
+// Cada pixel só é alterado por quem desenha nele, por isso a imagem pode ser usada pelo TiledRender3D.
+class ImageMultisample
+{
+	ImageRGB &img; // destino do resolve
+	const SamplePattern &pattern;
+	float sx[16], sy[16]; // posições das amostras, em pixels
+
+	std::vector<RGB> C; // pattern.count amostras por pixel, seguidas
+	std::vector<float> Z;
+
+public:
+	ImageMultisample(ImageRGB &img, int samples = 4, float clear_depth = 1)
+		: img{img}, pattern{::samplePattern(samples)},
+		  C(img.width() * img.height() * pattern.count),
+		  Z(img.width() * img.height() * pattern.count, clear_depth)
+	{
+		for (int s = 0; s < pattern.count; s++)
+		{
+			sx[s] = pattern.x[s] / float(1 << SUBPIXEL_BITS);
+			sy[s] = pattern.y[s] / float(1 << SUBPIXEL_BITS);
+		}
+	}
+
+	// pinta todas as amostras, como o fill do ImageRGB
+	void fill(RGB color) { std::fill(C.begin(), C.end(), color); }
+
+	// volta a profundidade ao estado inicial sem alocar memória, para reaproveitar a imagem no próximo quadro
+	void clear(float clear_depth = 1) { std::fill(Z.begin(), Z.end(), clear_depth); }
+
+	int width() const { return img.width(); }
+	int height() const { return img.height(); }
+
+	int samples() const { return pattern.count; }
+	const SamplePattern &samplePattern() const { return pattern; }
+
+	// pixel da imagem de destino, atualizado por resolve()
+	RGB &operator()(int x, int y) { return img(x, y); }
+
+	RGB &sample(int x, int y, int s) { return C[index(x, y) + s]; }
+	float depth(int x, int y, int s) const { return Z[index(x, y) + s]; }
+
+	// Teste de profundidade das amostras em coverage do pixel p. z é a profundidade no centro
+	// do pixel e dzdx, dzdy suas derivadas na tela. Grava a profundidade das amostras que passaram
+	// e devolve suas posições.
+	unsigned int testSamples(Pixel p, float z, float dzdx, float dzdy, unsigned int coverage)
+	{
+		float *d = &Z[index(p.x, p.y)];
+		unsigned int pass = 0;
+		for (; coverage; coverage &= coverage - 1)
+		{
+			int s = __builtin_ctz(coverage);
+			float zs = z + dzdx * sx[s] + dzdy * sy[s];
+			if (zs < d[s])
+			{
+				d[s] = zs;
+				pass |= 1u << s;
+			}
+		}
+		return pass;
+	}
+
+	// cor c nas amostras de mask do pixel p
+	void writeSamples(Pixel p, unsigned int mask, RGB c)
+	{
+		RGB *out = &C[index(p.x, p.y)];
+		for (; mask; mask &= mask - 1)
+			out[__builtin_ctz(mask)] = c;
+	}
+
+	// média das amostras de cada pixel, na imagem de destino
+	void resolve()
+	{
+		int n = pattern.count;
+		const unsigned char *in = reinterpret_cast<const unsigned char *>(C.data());
+		for (int y = 0; y < img.height(); y++)
+			for (int x = 0; x < img.width(); x++, in += n * sizeof(RGB))
+			{
+				unsigned char *out = reinterpret_cast<unsigned char *>(&img(x, y));
+				for (int k = 0; k < 3; k++)
+				{
+					int sum = 0;
+					for (int s = 0; s < n; s++)
+						sum += in[s * sizeof(RGB) + k];
+					out[k] = (sum + n / 2) / n;
+				}
+			}
+	}
+
+private:
+	size_t index(int x, int y) const { return ((size_t)y * img.width() + x) * pattern.count; }
+};
+
+template <class Varying>
+bool testPixel(Pixel p, Varying, ImageMultisample &img)
+{
+	return p.x >= 0 && p.y >= 0 && p.x < img.width() && p.y < img.height();
+}
+
+// Verdadeiro se a imagem tem várias amostras por pixel, como o ImageMultisample:
+// os pipelines rasterizam com máscaras de cobertura e escrevem com writeSamples
+template <class ImageType, class = void>
+struct is_multisample_image : std::false_type
+{
+};
+
+template <class ImageType>
+struct is_multisample_image<ImageType, std::void_t<decltype(std::declval<ImageType &>().samplePattern())>>
+	: std::true_type
+{
+};
@@ -0,0 +1,349 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "MappedFile.h"
+#include "ObjMesh.h"
+#include "ThreadPool.h"
+
+// Leitor de arquivos OBJ em paralelo, com a mesma interface do ObjMesh.
+// O arquivo é mapeado na memória e dividido em pedaços em inícios de linha. Cada pedaço
+// é lido por uma thread, sem iostream; os índices relativos (negativos) são corrigidos depois
+// com o número de vértices dos pedaços anteriores, e os usemtl com o número de triângulos.
+// Faces com mais de 3 vértices viram leques; sem vn, a normal é a do triângulo.
+// Dos materiais (mtllib) são lidos Kd e map_Kd.
+class ParallelObjMesh
+{
+public:
+	using Vertex = ObjMesh::Vertex;
+
+	std::string path; // diretório do OBJ
+
+	explicit ParallelObjMesh(const std::string &obj_file, ThreadPool &pool = defaultThreadPool())
+	{
+		size_t slash = obj_file.find_last_of("/\\");
+		path = slash == std::string::npos ? "" : obj_file.substr(0, slash + 1);
+
+		MappedFile file{obj_file};
+		const char *data = file.data(), *end = data + file.size();
+
+		// pedaços de pelo menos 1 MB, começando em inícios de linha
+		size_t nchunks = std::max<size_t>(1, std::min<size_t>(4 * pool.size(), file.size() >> 20));
+		std::vector<Chunk> chunks(nchunks);
+		const char *p = data;
+		for (size_t i = 0; i < nchunks; i++)
+		{
+			const char *q = i + 1 == nchunks ? end : std::max(p, data + file.size() * (i + 1) / nchunks);
+			while (q < end && q[-1] != '\n')
+				q++;
+			chunks[i].begin = p;
+			chunks[i].end = q;
+			p = q;
+		}
+
+		pool.parallel_for(nchunks, [&](unsigned int i) { chunks[i].parse(); });
+
+		// posição de cada pedaço nos arrays finais
+		size_t nv = 0, nvt = 0, nvn = 0, ntris = 0;
+		for (Chunk &c : chunks)
+		{
+			c.v_offset = nv;
+			c.vt_offset = nvt;
+			c.vn_offset = nvn;
+			c.tri_offset = ntris;
+			nv += c.v.size();
+			nvt += c.vt.size();
+			nvn += c.vn.size();
+			ntris += c.corners.size() / 3;
+		}
+
+		std::vector<vec3> V(nv), VN(nvn);
+		std::vector<vec2> VT(nvt);
+		tris.resize(3 * ntris);
+		pool.parallel_for(nchunks, [&](unsigned int i)
+		{
+			Chunk &c = chunks[i];
+			std::copy(c.v.begin(), c.v.end(), V.begin() + c.v_offset);
+			std::copy(c.vt.begin(), c.vt.end(), VT.begin() + c.vt_offset);
+			std::copy(c.vn.begin(), c.vn.end(), VN.begin() + c.vn_offset);
+		});
+		pool.parallel_for(nchunks, [&](unsigned int i) { chunks[i].resolve(V, VT, VN, &tris[3 * chunks[i].tri_offset]); });
+
+		// faixas de material, em triângulos; a primeira (sem usemtl) usa o material padrão
+		std::string current;
+		size_t first = 0;
+		for (const Chunk &c : chunks)
+			for (const auto &[tri, name] : c.usemtl)
+			{
+				size_t at = c.tri_offset + tri;
+				if (at > first)
+					ranges.push_back({current, 3 * (unsigned int)first, 3 * (unsigned int)(at - first)});
+				current = name;
+				first = at;
+			}
+		if (ntris > first)
+			ranges.push_back({current, 3 * (unsigned int)first, 3 * (unsigned int)(ntris - first)});
+
+		for (const Chunk &c : chunks)
+			for (const std::string &lib : c.mtllib)
+				loadMaterials(path + lib);
+	}
+
+	const std::vector<Vertex> &getTriangles() const { return tris; }
+
+	std::vector<MaterialRange> getMaterials(MaterialInfo std_mat) const
+	{
+		std::vector<MaterialRange> result;
+		for (const Range &r : ranges)
+		{
+			auto it = materials.find(r.material);
+			MaterialRange range;
+			range.mat = it == materials.end() ? std_mat : it->second;
+			range.first = r.first;
+			range.count = r.count;
+			result.push_back(range);
+		}
+		return result;
+	}
+
+private:
+	struct Range
+	{
+		std::string material;
+		unsigned int first, count; // em vértices, como MaterialRange
+	};
+
+	std::vector<Vertex> tris;
+	std::vector<Range> ranges;
+	std::map<std::string, MaterialInfo> materials;
+
+	static constexpr int missing = INT_MIN;
+
+	// índices de um canto de face: globais a partir de 0, ou locais ao pedaço (bit de relative)
+	struct Corner
+	{
+		int v, vt, vn;
+	};
+
+	struct Chunk
+	{
+		const char *begin, *end;
+		std::vector<vec3> v, vn;
+		std::vector<vec2> vt;
+		std::vector<Corner> corners;		// 3 por triângulo
+		std::vector<unsigned char> relative; // por canto: bits 1, 2 e 4 para v, vt e vn
+		std::vector<std::pair<size_t, std::string>> usemtl; // triângulo do pedaço e material
+		std::vector<std::string> mtllib;
+		size_t v_offset, vt_offset, vn_offset, tri_offset;
+
+		void parse()
+		{
+			std::vector<Corner> face;
+			std::vector<unsigned char> face_relative;
+			for (const char *p = begin; p < end;)
+			{
+				const char *eol = std::find(p, end, '\n');
+				p = skipSpaces(p, eol);
+				if (eol - p >= 2 && p[0] == 'v' && isSpace(p[1]))
+				{
+					vec3 x;
+					const char *q = p + 1;
+					for (int k = 0; k < 3; k++)
+						q = parseFloat(q, eol, x[k]);
+					v.push_back(x);
+				}
+				else if (eol - p >= 3 && p[0] == 'v' && p[1] == 't' && isSpace(p[2]))
+				{
+					vec2 x;
+					const char *q = p + 2;
+					for (int k = 0; k < 2; k++)
+						q = parseFloat(q, eol, x[k]);
+					vt.push_back(x);
+				}
+				else if (eol - p >= 3 && p[0] == 'v' && p[1] == 'n' && isSpace(p[2]))
+				{
+					vec3 x;
+					const char *q = p + 2;
+					for (int k = 0; k < 3; k++)
+						q = parseFloat(q, eol, x[k]);
+					vn.push_back(x);
+				}
+				else if (eol - p >= 2 && p[0] == 'f' && isSpace(p[1]))
+				{
+					face.clear();
+					face_relative.clear();
+					for (const char *q = skipSpaces(p + 1, eol); q < eol; q = skipSpaces(q, eol))
+					{
+						Corner c = {missing, missing, missing};
+						unsigned char rel = 0;
+						q = parseIndex(q, eol, v.size(), c.v, rel, 1);
+						if (q < eol && *q == '/')
+						{
+							q++;
+							if (q < eol && *q != '/')
+								q = parseIndex(q, eol, vt.size(), c.vt, rel, 2);
+							if (q < eol && *q == '/')
+								q = parseIndex(q + 1, eol, vn.size(), c.vn, rel, 4);
+						}
+						while (q < eol && !isSpace(*q)) // resto de um canto mal formado
+							q++;
+						face.push_back(c);
+						face_relative.push_back(rel);
+					}
+					for (size_t j = 1; j + 1 < face.size(); j++)
+						for (size_t k : {size_t{0}, j, j + 1})
+						{
+							corners.push_back(face[k]);
+							relative.push_back(face_relative[k]);
+						}
+				}
+				else if (startsWith(p, eol, "usemtl"))
+					usemtl.push_back({corners.size() / 3, restOfLine(p + 6, eol)});
+				else if (startsWith(p, eol, "mtllib"))
+					mtllib.push_back(restOfLine(p + 6, eol));
+
+				p = eol + 1;
+			}
+		}
+
+		// escreve os vértices dos triângulos do pedaço em out, com os índices já globais
+		void resolve(const std::vector<vec3> &V, const std::vector<vec2> &VT, const std::vector<vec3> &VN, Vertex *out) const
+		{
+			for (size_t t = 0; t < corners.size(); t += 3)
+			{
+				bool has_normal = true;
+				for (int k = 0; k < 3; k++)
+				{
+					const Corner &c = corners[t + k];
+					unsigned char rel = relative[t + k];
+					int iv = global(c.v, rel & 1, v_offset, V.size());
+					int ivt = global(c.vt, rel & 2, vt_offset, VT.size());
+					int ivn = global(c.vn, rel & 4, vn_offset, VN.size());
+
+					Vertex &X = out[t + k];
+					X = Vertex{};
+					if (iv != missing)
+						X.position = V[iv];
+					if (ivt != missing)
+						X.texCoords = VT[ivt];
+					if (ivn != missing)
+						X.normal = VN[ivn];
+					else
+						has_normal = false;
+				}
+
+				if (!has_normal)
+				{
+					vec3 a = out[t + 1].position - out[t].position;
+					vec3 b = out[t + 2].position - out[t].position;
+					vec3 n = {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+					float len = norm(n);
+					if (len > 0)
+						n = (1 / len) * n;
+					for (int k = 0; k < 3; k++)
+						out[t + k].normal = n;
+				}
+			}
+		}
+
+		static int global(int i, bool rel, size_t offset, size_t size)
+		{
+			if (i == missing)
+				return missing;
+			long long g = rel ? (long long)offset + i : i;
+			return g >= 0 && g < (long long)size ? (int)g : missing;
+		}
+
+		// índice OBJ (a partir de 1, ou negativo a partir do fim): guarda a posição a partir de 0,
+		// local ao pedaço se for relativo
+		static const char *parseIndex(const char *p, const char *end, size_t count, int &index, unsigned char &rel,
+									  unsigned char bit)
+		{
+			int i = 0;
+			auto r = std::from_chars(p, end, i);
+			if (r.ec != std::errc() || i == 0)
+				return r.ptr;
+			if (i < 0)
+			{
+				index = (int)count + i;
+				rel |= bit;
+			}
+			else
+				index = i - 1;
+			return r.ptr;
+		}
+	};
+
+	static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+	static const char *skipSpaces(const char *p, const char *end)
+	{
+		while (p < end && isSpace(*p))
+			p++;
+		return p;
+	}
+
+	static bool startsWith(const char *p, const char *end, const char *word)
+	{
+		size_t n = strlen(word);
+		return (size_t)(end - p) > n && memcmp(p, word, n) == 0 && isSpace(p[n]);
+	}
+
+	static std::string restOfLine(const char *p, const char *end)
+	{
+		p = skipSpaces(p, end);
+		while (end > p && isSpace(end[-1]))
+			end--;
+		return std::string(p, end);
+	}
+
+	// número em ponto flutuante, sem locale; 0 se não houver número
+	static const char *parseFloat(const char *p, const char *end, float &x)
+	{
+		p = skipSpaces(p, end);
+		if (p < end && *p == '+')
+			p++;
+		x = 0;
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+		auto r = std::from_chars(p, end, x);
+		return r.ec == std::errc() ? r.ptr : p;
+#else
+		const char *q = std::find_if(p, end, isSpace);
+		x = strtof(std::string(p, q).c_str(), nullptr);
+		return q;
+#endif
+	}
+
+	void loadMaterials(const std::string &mtl_file)
+	{
+		MappedFile file{mtl_file};
+		const char *p = file.data(), *end = p + file.size();
+		MaterialInfo *current = nullptr;
+		for (; p < end; p++)
+		{
+			const char *eol = std::find(p, end, '\n');
+			p = skipSpaces(p, eol);
+			if (startsWith(p, eol, "newmtl"))
+			{
+				current = &materials[restOfLine(p + 6, eol)];
+				*current = MaterialInfo{};
+			}
+			else if (current && startsWith(p, eol, "Kd"))
+			{
+				const char *q = p + 2;
+				for (int k = 0; k < 3; k++)
+					q = parseFloat(q, eol, current->Kd[k]);
+			}
+			else if (current && startsWith(p, eol, "map_Kd"))
+				current->map_Kd = restOfLine(p + 6, eol);
+			p = eol;
+		}
+	}
+};
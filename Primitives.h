@@ -3,8 +3,20 @@
 
 #include <cstddef>
 #include <array>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+// Tipo dos vértices de V, que pode ser um ponteiro ou qualquer objeto com operator[]
+template <class Vertices>
+using VertexOf = std::decay_t<decltype(std::declval<const Vertices &>()[0])>;
+
+// V[i] == i: P.assemble(i, VertexIndices{}) devolve os índices dos vértices da primitiva i
+struct VertexIndices
+{
+	unsigned int operator[](unsigned int i) const { return i; }
+};
+
 template <class Prims, class Cont>
 auto assemble(const Prims &P, const Cont &V)
 {
@@ -28,8 +40,8 @@ public:
 
 	size_t size() const { return n; }
 
-	template <typename Vertex>
-	Line<Vertex> assemble(unsigned int i, const Vertex *V) const
+	template <class Vertices>
+	Line<VertexOf<Vertices>> assemble(unsigned int i, const Vertices &V) const
 	{
 		return {V[2 * i], V[2 * i + 1]};
 	}
@@ -54,8 +66,8 @@ public:
 
 	size_t size() const { return n; }
 
-	template <typename Vertex>
-	Line<Vertex> assemble(unsigned int i, const Vertex *V) const
+	template <class Vertices>
+	Line<VertexOf<Vertices>> assemble(unsigned int i, const Vertices &V) const
 	{
 		return {V[i], V[i + 1]};
 	}
@@ -70,8 +82,8 @@ public:
 
 	size_t size() const { return n; }
 
-	template <typename Vertex>
-	Line<Vertex> assemble(unsigned int i, const Vertex *V) const
+	template <class Vertices>
+	Line<VertexOf<Vertices>> assemble(unsigned int i, const Vertices &V) const
 	{
 		return {V[i % n], V[(i + 1) % n]};
 	}
@@ -90,8 +102,8 @@ public:
 
 	size_t size() const { return n; }
 
-	template <typename Vertex>
-	Triangle<Vertex> assemble(unsigned int i, const Vertex *V) const
+	template <class Vertices>
+	Triangle<VertexOf<Vertices>> assemble(unsigned int i, const Vertices &V) const
 	{
 		return {V[3 * i], V[3 * i + 1], V[3 * i + 2]};
 	}
@@ -116,8 +128,8 @@ public:
 
 	size_t size() const { return n; }
 
-	template <typename Vertex>
-	Triangle<Vertex> assemble(unsigned int i, const Vertex *V) const
+	template <class Vertices>
+	Triangle<VertexOf<Vertices>> assemble(unsigned int i, const Vertices &V) const
 	{
 		return {V[i], V[i + 1], V[i + 2]};
 	}
@@ -142,8 +154,8 @@ public:
 
 	size_t size() const { return n; }
 
-	template <typename Vertex>
-	Triangle<Vertex> assemble(unsigned int i, const Vertex *V) const
+	template <class Vertices>
+	Triangle<VertexOf<Vertices>> assemble(unsigned int i, const Vertices &V) const
 	{
 		return {V[0], V[i + 1], V[i + 2]};
 	}
@@ -159,8 +171,8 @@ public:
 
 	size_t size() const { return n; }
 
-	template <typename Vertex>
-	Triangle<Vertex> assemble(unsigned int i, const Vertex *V) const
+	template <class Vertices>
+	Triangle<VertexOf<Vertices>> assemble(unsigned int i, const Vertices &V) const
 	{
 		return {V[first + 3 * i], V[first + 3 * i + 1], V[first + 3 * i + 2]};
 	}
@@ -179,20 +191,20 @@ public:
 
 	size_t size() const { return P.size(); }
 
-	template <typename Vertex>
-	auto assemble(unsigned int i, const Vertex *V) const
+	template <class Vertices>
+	auto assemble(unsigned int i, const Vertices &V) const
 	{
 		return assemble(P.assemble(i, indices), V);
 	}
 
-	template <typename Vertex>
-	Line<Vertex> assemble(Line<unsigned int> indices, const Vertex *V) const
+	template <class Vertices>
+	Line<VertexOf<Vertices>> assemble(Line<unsigned int> indices, const Vertices &V) const
 	{
 		return {V[indices[0]], V[indices[1]]};
 	}
 
-	template <typename Vertex>
-	Triangle<Vertex> assemble(Triangle<unsigned int> indices, const Vertex *V) const
+	template <class Vertices>
+	Triangle<VertexOf<Vertices>> assemble(Triangle<unsigned int> indices, const Vertices &V) const
 	{
 		return {V[indices[0]], V[indices[1]], V[indices[2]]};
 	}
@@ -210,13 +222,13 @@ public:
 
 	size_t size() const { return 3 * P.size(); }
 
-	template <typename Vertex>
-	Line<Vertex> assemble(unsigned int i, const Vertex *V) const
+	template <class Vertices>
+	Line<VertexOf<Vertices>> assemble(unsigned int i, const Vertices &V) const
 	{
 		unsigned j = i / 3;
 		unsigned k = i % 3;
 
-		Triangle<Vertex> tri = P.assemble(j, V);
+		Triangle<VertexOf<Vertices>> tri = P.assemble(j, V);
 
 		return {tri[k], tri[(k + 1) % 3]};
 	}
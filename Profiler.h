@@ -0,0 +1,384 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Medição do pipeline (Render3D, TiledRender3D, Render2dPipeline e recorte): tempo de cada etapa
+// e contadores de primitivas e fragmentos, somados sobre todas as threads.
+//
+// Em tempo de compilação, -DRENDER_PROFILE=0 tira toda a medição do código.
+// Em tempo de execução, ela só é feita com pipelineProfiler().enabled = true; desligada,
+// custa um teste de ponteiro nulo por fragmento.
+//
+// Os tempos são exclusivos: uma etapa dentro de outra (o desenho chamado pelo recorte,
+// o sombreamento chamado pelo rasterizador) não é contada duas vezes.
+// Medir cada fragmento atrasa o desenho, então os tempos servem para comparar as etapas,
+// não como tempo real do quadro.
+#ifndef RENDER_PROFILE
+#define RENDER_PROFILE 1
+#endif
+
+enum PipelineStage
+{
+	STAGE_VERTEX,	// vertexShader
+	STAGE_ASSEMBLE, // montagem das primitivas
+	STAGE_CLIP,		// recorte e descarte pela orientação
+	STAGE_BIN,		// distribuição nos ladrilhos (TiledRender3D)
+	STAGE_SETUP,	// preparação do triângulo para o rasterizador
+	STAGE_RASTER,	// percorrer os pixels cobertos
+	STAGE_DEPTH,	// testes de profundidade
+	STAGE_FRAGMENT, // interpolação dos varyings e fragmentShader
+	STAGE_COUNT
+};
+
+inline const char *stageName(int stage)
+{
+	static const char *names[STAGE_COUNT] = {"vertex", "assemble", "clip", "bin", "setup", "raster", "depth", "fragment"};
+	return names[stage];
+}
+
+struct PipelineCounters
+{
+	uint64_t ticks[STAGE_COUNT] = {};
+
+	uint64_t primitives_in = 0;		 // montadas
+	uint64_t primitives_culled = 0;	 // descartadas pela orientação
+	uint64_t primitives_outside = 0; // inteiramente fora do volume de visão
+	uint64_t primitives_clipped = 0; // cortadas pelo recorte
+	uint64_t primitive_setups = 0;	 // preparadas para o rasterizador (no TiledRender3D, uma vez por ladrilho)
+
+	uint64_t fragments_generated = 0; // pixels cobertos visitados pelo rasterizador
+	uint64_t fragments_rejected = 0;  // descartados pelos testes de profundidade
+	uint64_t fragments_written = 0;	  // sombreados e escritos
+
+	void add(const PipelineCounters &c)
+	{
+		for (int s = 0; s < STAGE_COUNT; s++)
+			ticks[s] += c.ticks[s];
+		primitives_in += c.primitives_in;
+		primitives_culled += c.primitives_culled;
+		primitives_outside += c.primitives_outside;
+		primitives_clipped += c.primitives_clipped;
+		primitive_setups += c.primitive_setups;
+		fragments_generated += c.fragments_generated;
+		fragments_rejected += c.fragments_rejected;
+		fragments_written += c.fragments_written;
+	}
+};
+
+// Resultado da medição desde o último reset
+struct PipelineStats
+{
+	double wall_ms = 0;
+	double stage_ms[STAGE_COUNT] = {}; // somado sobre as threads
+	PipelineCounters counters;
+
+	// sobreposição: overdraw[k] pixels escritos k vezes (o último, max_overdraw ou mais)
+	static constexpr int max_overdraw = 16;
+	uint64_t overdraw[max_overdraw + 1] = {};
+	uint64_t pixels_written = 0;
+
+	double averageOverdraw() const
+	{
+		return pixels_written ? (double)counters.fragments_written / pixels_written : 0;
+	}
+
+	std::string json() const
+	{
+		std::string s = "{\n";
+		auto number = [](double x) { char b[32]; snprintf(b, sizeof b, "%.6g", x); return std::string(b); };
+		auto integer = [](uint64_t x) { char b[32]; snprintf(b, sizeof b, "%llu", (unsigned long long)x); return std::string(b); };
+		auto field = [&](const char *name, double x, bool last = false)
+		{
+			s += std::string("    \"") + name + "\": " + number(x) + (last ? "\n" : ",\n");
+		};
+		// contadores sem arredondamento
+		auto count = [&](const char *name, uint64_t x, bool last = false)
+		{
+			s += std::string("    \"") + name + "\": " + integer(x) + (last ? "\n" : ",\n");
+		};
+
+		s += "  \"wall_ms\": " + number(wall_ms) + ",\n";
+		s += "  \"stages_ms\": {\n";
+		for (int i = 0; i < STAGE_COUNT; i++)
+			field(stageName(i), stage_ms[i], i + 1 == STAGE_COUNT);
+		s += "  },\n  \"primitives\": {\n";
+		count("in", counters.primitives_in);
+		count("culled", counters.primitives_culled);
+		count("outside", counters.primitives_outside);
+		count("clipped", counters.primitives_clipped);
+		count("setups", counters.primitive_setups, true);
+		s += "  },\n  \"fragments\": {\n";
+		count("generated", counters.fragments_generated);
+		count("rejected", counters.fragments_rejected);
+		count("written", counters.fragments_written, true);
+		s += "  },\n  \"overdraw\": {\n";
+		count("pixels_written", pixels_written);
+		field("average", averageOverdraw());
+		s += "    \"histogram\": [";
+		for (int k = 0; k <= max_overdraw; k++)
+			s += integer(overdraw[k]) + (k < max_overdraw ? ", " : "]\n");
+		s += "  }\n}\n";
+		return s;
+	}
+};
+
+// relógio da medição: o contador de ciclos, se houver
+inline uint64_t profileTicks()
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Medição de uma thread: só ela escreve, sem disputa
+struct ThreadProfile
+{
+	struct Event
+	{
+		const char *name;
+		uint64_t begin, end;
+	};
+
+	PipelineCounters counters;
+	std::vector<Event> events; // para o Chrome trace
+	unsigned int id;
+
+	int stage = -1; // etapa em andamento
+	uint64_t since = 0;
+
+	// entra na etapa s e devolve a anterior
+	int enter(int s)
+	{
+		uint64_t now = profileTicks();
+		if (stage >= 0)
+			counters.ticks[stage] += now - since;
+		since = now;
+		std::swap(stage, s);
+		return s;
+	}
+
+	void leave(int previous) { enter(previous); }
+};
+
+class PipelineProfiler
+{
+	mutable std::mutex mutex;
+	std::vector<std::unique_ptr<ThreadProfile>> threads; // nunca liberados: as threads guardam ponteiros
+
+	std::vector<uint16_t> writes; // escritas por pixel
+	int width = 0, height = 0;
+
+	uint64_t origin_ticks = profileTicks();
+	std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+public:
+	std::atomic<bool> enabled{false};
+	std::atomic<bool> trace{false}; // guarda também os eventos do Chrome trace
+	size_t max_events = 1 << 20;	// por thread
+
+	ThreadProfile *registerThread()
+	{
+		std::lock_guard<std::mutex> lock{mutex};
+		threads.push_back(std::make_unique<ThreadProfile>());
+		threads.back()->id = threads.size();
+		return threads.back().get();
+	}
+
+	// Zera a medição. Como stats(), só pode ser chamado quando nada está sendo desenhado.
+	void reset()
+	{
+		std::lock_guard<std::mutex> lock{mutex};
+		for (auto &t : threads)
+		{
+			t->counters = PipelineCounters{};
+			t->events.clear();
+		}
+		std::fill(writes.begin(), writes.end(), 0);
+		origin_ticks = profileTicks();
+		origin = std::chrono::steady_clock::now();
+	}
+
+	// Prepara a contagem de sobreposição para uma imagem de width x height pixels.
+	// Chamado por quem desenha antes de dividir o trabalho entre threads; uma imagem por vez.
+	void target(int w, int h)
+	{
+		std::lock_guard<std::mutex> lock{mutex};
+		if (w == width && h == height)
+			return;
+		width = w;
+		height = h;
+		writes.assign((size_t)w * h, 0);
+	}
+
+	// Conta uma escrita no pixel (x, y). Threads diferentes escrevem em pixels diferentes.
+	void written(int x, int y)
+	{
+		if (x < width && y < height)
+		{
+			uint16_t &n = writes[(size_t)y * width + x];
+			n += n < UINT16_MAX;
+		}
+	}
+
+	PipelineStats stats() const
+	{
+		std::lock_guard<std::mutex> lock{mutex};
+		PipelineStats s;
+		for (const auto &t : threads)
+			s.counters.add(t->counters);
+
+		s.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - origin).count();
+		for (int i = 0; i < STAGE_COUNT; i++)
+			s.stage_ms[i] = s.counters.ticks[i] * msPerTick();
+
+		for (uint16_t n : writes)
+			if (n > 0)
+			{
+				s.pixels_written++;
+				s.overdraw[std::min<int>(n, PipelineStats::max_overdraw)]++;
+			}
+		return s;
+	}
+
+	bool writeJSON(const std::string &file) const
+	{
+		FILE *f = fopen(file.c_str(), "w");
+		if (!f)
+			return false;
+		std::string s = stats().json();
+		bool ok = fwrite(s.data(), 1, s.size(), f) == s.size();
+		return fclose(f) == 0 && ok;
+	}
+
+	// Eventos no formato do chrome://tracing (e do Perfetto), uma linha por thread
+	bool writeChromeTrace(const std::string &file) const
+	{
+		FILE *f = fopen(file.c_str(), "w");
+		if (!f)
+			return false;
+
+		std::lock_guard<std::mutex> lock{mutex};
+		double us = 1000 * msPerTick();
+		fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+		const char *separator = "";
+		for (const auto &t : threads)
+			for (const ThreadProfile::Event &e : t->events)
+			{
+				fprintf(f, "%s{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}",
+						separator, e.name, t->id, (double)(e.begin - origin_ticks) * us, (double)(e.end - e.begin) * us);
+				separator = ",\n";
+			}
+		fprintf(f, "\n]}\n");
+		return fclose(f) == 0;
+	}
+
+private:
+	// o contador de ciclos é convertido pelo relógio do sistema, medido desde o reset (pelo menos 10 ms)
+	double msPerTick() const
+	{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+		uint64_t ticks;
+		double ms;
+		do
+		{
+			ticks = profileTicks() - origin_ticks;
+			ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - origin).count();
+		} while (ms < 10);
+		return ms / ticks;
+#else
+		return 1e-6;
+#endif
+	}
+};
+
+inline PipelineProfiler &pipelineProfiler()
+{
+	static PipelineProfiler profiler;
+	return profiler;
+}
+
+// medição da thread atual, ou nullptr se estiver desligada
+inline ThreadProfile *profiling()
+{
+#if RENDER_PROFILE
+	PipelineProfiler &profiler = pipelineProfiler();
+	if (!profiler.enabled.load(std::memory_order_relaxed))
+		return nullptr;
+	thread_local ThreadProfile *local = nullptr;
+	if (!local)
+		local = profiler.registerThread();
+	return local;
+#else
+	return nullptr;
+#endif
+}
+
+// conta o tempo do bloco na etapa stage
+class ProfileStage
+{
+	ThreadProfile *profile;
+	int previous = -1;
+
+public:
+	ProfileStage(ThreadProfile *profile, PipelineStage stage) : profile{profile}
+	{
+		if (profile)
+			previous = profile->enter(stage);
+	}
+
+	~ProfileStage() { stop(); }
+
+	// termina a etapa antes do fim do bloco
+	void stop()
+	{
+		if (profile)
+			profile->leave(previous);
+		profile = nullptr;
+	}
+
+	ProfileStage(const ProfileStage &) = delete;
+	ProfileStage &operator=(const ProfileStage &) = delete;
+};
+
+// evento do Chrome trace com a duração do bloco; name deve ser uma string literal
+class ProfileEvent
+{
+	ThreadProfile *profile = nullptr;
+	const char *name;
+	uint64_t begin = 0;
+
+public:
+	ProfileEvent(ThreadProfile *p, const char *name) : name{name}
+	{
+		if (p && pipelineProfiler().trace.load(std::memory_order_relaxed) &&
+			p->events.size() < pipelineProfiler().max_events)
+		{
+			profile = p;
+			begin = profileTicks();
+		}
+	}
+
+	~ProfileEvent()
+	{
+		if (profile)
+			profile->events.push_back({name, begin, profileTicks()});
+	}
+
+	ProfileEvent(const ProfileEvent &) = delete;
+	ProfileEvent &operator=(const ProfileEvent &) = delete;
+};
@@ -7,64 +7,114 @@
 #include "Primitives.h"
 #include "rasterization.h"
 #include "Clip2D.h"
+#include "Multisample.h"
+#include "Profiler.h"
 
+// ImageType: ImageRGB ou, com multiamostragem, ImageMultisample (a cor é calculada uma vez por pixel)
+template <class ImageType = ImageRGB>
 struct Render2dPipeline
 {
-	ImageRGB &image;
+	ImageType &image;
+	ThreadProfile *profile = profiling(); // Profiler.h
 
 	template <class Vertices, class Prims>
 	void run(const Vertices &V, const Prims &P)
 	{
+		ProfileEvent event{profile, "Render2D"};
+		if (profile)
+			pipelineProfiler().target(image.width(), image.height());
+
+		ProfileStage stage{profile, STAGE_ASSEMBLE};
+		auto primitives = assemble(P, V);
+		if (profile)
+			profile->counters.primitives_in += primitives.size();
+
+		ProfileStage clip_stage{profile, STAGE_CLIP};
 		ClipRectangle R = {-0.5f, -0.5f, image.width() - 0.5f, image.height() - 0.5f};
-		for (auto primitive : clip(assemble(P, V), R))
+		auto clipped = clip(primitives, R);
+		clip_stage.stop();
+		stage.stop();
+
+		for (auto primitive : clipped)
 			draw(primitive);
 	}
 
-	void paint(Pixel p, RGB c)
+	// coverage: amostras do pixel que recebem a cor, com multiamostragem
+	void paint(Pixel p, RGB c, unsigned int coverage = ~0u)
 	{
+		if (profile)
+			profile->counters.fragments_generated++;
+
 		if (p.x >= 0 && p.y >= 0 && p.x < image.width() && p.y < image.height())
-			image(p.x, p.y) = c;
+		{
+			if constexpr (is_multisample_image<ImageType>::value)
+				image.writeSamples(p, coverage & ((1u << image.samples()) - 1), c);
+			else
+				image(p.x, p.y) = c;
+			if (profile)
+			{
+				profile->counters.fragments_written++;
+				pipelineProfiler().written(p.x, p.y);
+			}
+		}
+		else if (profile)
+			profile->counters.fragments_rejected++;
 	}
 
 	template <class Vertex>
 	void draw(Line<Vertex> line)
 	{
+		ProfileStage setup{profile, STAGE_SETUP};
+		if (profile)
+			profile->counters.primitive_setups++;
 		vec2 L[] = {get2DPosition(line[0]), get2DPosition(line[1])};
 		RGB C[] = {line[0].color, line[1].color};
 
-		for (Pixel p : rasterizeLine(L))
+		ProfileStage raster{profile, STAGE_RASTER};
+		rasterizeLine(L, [&](Pixel p)
 		{
+			ProfileStage stage{profile, STAGE_FRAGMENT};
 			float t = find_mix_param(toVec2(p), L[0], L[1]);
 			RGB color = lerp(t, C[0], C[1]);
 			paint(p, color);
-		};
+		});
 	}
 
 	template <class Vertex>
 	void draw(Triangle<Vertex> tri)
 	{
+		ProfileStage setup{profile, STAGE_SETUP};
+		if (profile)
+			profile->counters.primitive_setups++;
 		vec2 T[] = {get2DPosition(tri[0]), get2DPosition(tri[1]), get2DPosition(tri[2])};
 		RGB C[] = {tri[0].color, tri[1].color, tri[2].color};
 
-		for (Pixel p : rasterizeTriangle(T))
+		PixelRect R = {0, 0, image.width(), image.height()};
+		auto fragment = [&](Pixel p, vec3 alpha, unsigned int coverage)
 		{
-			vec3 alpha = barycentric_coords(toVec2(p), T);
+			ProfileStage stage{profile, STAGE_FRAGMENT};
 			vec3 lerpCor = alpha[0] * toVec(C[0]) + alpha[1] * toVec(C[1]) + alpha[2] * toVec(C[2]);
 			RGB cor = toColor(lerpCor);
-			paint(p, cor);
-		}
+			paint(p, cor, coverage);
+		};
+
+		ProfileStage raster{profile, STAGE_RASTER};
+		if constexpr (is_multisample_image<ImageType>::value)
+			rasterizeTriangleSamples(T, R, image.samplePattern(), fragment, [](PixelRect) { return true; });
+		else
+			rasterizeTriangle(T, R, [&](Pixel p, vec3 alpha) { fragment(p, alpha, 1u); });
 	}
 };
 
-template <class Vertices, class Prims>
-void render2d(const Vertices &V, const Prims &P, ImageRGB &image)
+template <class Vertices, class Prims, class ImageType>
+void render2d(const Vertices &V, const Prims &P, ImageType &image)
 {
-	Render2dPipeline pipeline{image};
+	Render2dPipeline<ImageType> pipeline{image};
 	pipeline.run(V, P);
 }
 
-template <class Vertices, class Prims>
-void render2d(const Vertices &V, const Prims &P, RGB color, ImageRGB &image)
+template <class Vertices, class Prims, class ImageType>
+void render2d(const Vertices &V, const Prims &P, RGB color, ImageType &image)
 {
 	using Vertex = std::remove_const_t<std::remove_reference_t<decltype(V[0])>>;
 	std::vector<PosCol<Vertex>> VC;
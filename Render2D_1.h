@@ -33,12 +33,12 @@ struct Render2dPipeline
 		vec2 L[] = {line[0].position, line[1].position};
 		RGB C[] = {line[0].color, line[1].color};
 
-		for (Pixel p : rasterizeLine(L))
+		rasterizeLine(L, [&](Pixel p)
 		{
 			float t = find_mix_param(toVec2(p), L[0], L[1]);
 			RGB color = lerp(t, C[0], C[1]);
 			paint(p, color);
-		};
+		});
 	}
 
 	void draw(Triangle<Vec2Col> tri)
@@ -48,13 +48,13 @@ struct Render2dPipeline
 		RGB C[] = {tri[0].color, tri[1].color, tri[2].color};
 		vec3 c[] = {toVec(C[0]), toVec(C[1]), toVec(C[2])};
 
-		for (Pixel p : rasterizeTriangle(T))
+		PixelRect R = {0, 0, image.width(), image.height()};
+		rasterizeTriangle(T, R, [&](Pixel p, vec3 alpha)
 		{
-			vec3 alpha = barycentric_coords(toVec2(p), T);
 			vec3 cor = alpha[0] * c[0] + alpha[1] * c[1] + alpha[2] * c[2];
 			RGB color = toColor(cor);
 			paint(p, color);
-		}
+		});
 	}
 };
 
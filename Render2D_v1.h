@@ -22,15 +22,14 @@ struct Render2dPipeline{
 	template<class Vertex>
 	void draw(Line<Vertex> line, RGB color){
 		vec2 L[] = {get2DPosition(line[0]), get2DPosition(line[1])};
-		for(Pixel p: rasterizeLine(L))
-			paint(p, color);
+		rasterizeLine(L, [&](Pixel p){ paint(p, color); });
 	}
 	
 	template<class Vertex>
 	void draw(Triangle<Vertex> tri, RGB color){
 		vec2 T[] = {get2DPosition(tri[0]), get2DPosition(tri[1]), get2DPosition(tri[2])};
-		for(Pixel p: rasterizeTriangle(T))
-			paint(p, color);
+		PixelRect R = {0, 0, image.width(), image.height()};
+		rasterizeTriangle(T, R, [&](Pixel p, vec3){ paint(p, color); });
 	}
 };
 
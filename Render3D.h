@@ -1,65 +1,524 @@
 #pragma once
 
+#include <algorithm>
+#include <climits>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include "geometry.h"
 #include "Image.h"
 #include "Primitives.h"
 #include "rasterization.h"
 #include "Clip3D.h"
+#include "BoundingBox.h"
+#include "VertexCache.h"
+#include "Multisample.h"
+#include "Profiler.h"
+
+// Resultado do teste de profundidade antecipado de um bloco de pixels
+enum DepthTest
+{
+	DEPTH_CULL, // tudo atrás: descarta o bloco
+	DEPTH_TEST, // testa cada fragmento
+	DEPTH_PASS	// tudo na frente: os fragmentos só escrevem a profundidade
+};
+
+// Descarte de triângulos pela orientação na tela. Como no OpenGL, a frente é o lado
+// em que os vértices aparecem no sentido anti-horário.
+enum CullFace
+{
+	CULL_NONE,
+	CULL_BACK,
+	CULL_FRONT
+};
+
+struct Culling
+{
+	CullFace face = CULL_NONE;
+	bool before_clip = false; // testa antes do recorte, nas coordenadas de recorte: os descartados nem são recortados
+};
+
+// verdadeiro se um triângulo com a área (com sinal) area na tela é descartado
+inline bool culled(CullFace face, float area)
+{
+	return (face == CULL_BACK && area < 0) || (face == CULL_FRONT && area > 0);
+}
+
+// Área com sinal do triângulo na tela, a menos de um fator, calculada antes da divisão por w:
+// o determinante das coordenadas x, y e w. Com w > 0 nos três vértices, o fator é positivo;
+// com vértices atrás da câmera, o sinal continua o da parte visível do triângulo.
+inline float clipSpaceArea(vec4 A, vec4 B, vec4 C)
+{
+	return A[0] * (B[1] * C[3] - B[3] * C[1]) -
+		   A[1] * (B[0] * C[3] - B[3] * C[0]) +
+		   A[3] * (B[0] * C[1] - B[1] * C[0]);
+}
+
+// Profundidade (z/w) de um triângulo como função afim da posição na tela
+struct DepthPlane
+{
+	float a, b, c;	  // z = a*x + b*y + c
+	float zmin, zmax; // intervalo de profundidade dos vértices
+
+	DepthPlane(const vec2 T[3], vec3 z)
+	{
+		float det = (T[1][0] - T[0][0]) * (T[2][1] - T[0][1]) - (T[2][0] - T[0][0]) * (T[1][1] - T[0][1]);
+		a = ((z[1] - z[0]) * (T[2][1] - T[0][1]) - (z[2] - z[0]) * (T[1][1] - T[0][1])) / det;
+		b = ((z[2] - z[0]) * (T[1][0] - T[0][0]) - (z[1] - z[0]) * (T[2][0] - T[0][0])) / det;
+		c = z[0] - a * T[0][0] - b * T[0][1];
+		zmin = std::min({z[0], z[1], z[2]});
+		zmax = std::max({z[0], z[1], z[2]});
+	}
+
+	// Intervalo de profundidade do triângulo dentro do retângulo R.
+	// A margem cobre o arredondamento dos vértices feito pelo rasterizador.
+	std::pair<float, float> range(PixelRect R) const
+	{
+		float margin = (fabs(a) + fabs(b)) / (1 << SUBPIXEL_BITS);
+		float lo = c + a * (a > 0 ? R.x0 : R.x1 - 1) + b * (b > 0 ? R.y0 : R.y1 - 1) - margin;
+		float hi = c + a * (a > 0 ? R.x1 - 1 : R.x0) + b * (b > 0 ? R.y1 - 1 : R.y0) + margin;
+		if (!std::isfinite(lo) || !std::isfinite(hi))
+			return {zmin, zmax};
+		return {std::max(lo, zmin), std::min(hi, zmax)};
+	}
+};
+
+// Teste de profundidade antecipado (early-Z), feito antes da interpolação dos varyings.
+// Por padrão nada é descartado e a profundidade fica por conta de testPixel;
+// imagens com ZBuffer hierárquico sobrecarregam estas funções (HiZBuffer.h).
+template <class ImageType>
+bool earlyTriangleTest(ImageType &, PixelRect, float)
+{
+	return true;
+}
+
+template <class ImageType>
+DepthTest earlyBlockTest(ImageType &, PixelRect, float, float)
+{
+	return DEPTH_TEST;
+}
+
+template <class ImageType>
+bool earlyDepthTest(ImageType &, Pixel, float, DepthTest)
+{
+	return true;
+}
+
+// Verdadeiro se o shader tem a versão em lote do vertexShader:
+// vertexShader(V, first, n, out) transforma os vértices first, ..., first+n-1 de V (ver SoA.h)
+template <class Shader, class VertexAttrib, class Varying, class = void>
+struct has_batch_vertex_shader : std::false_type
+{
+};
+
+template <class Shader, class VertexAttrib, class Varying>
+struct has_batch_vertex_shader<Shader, VertexAttrib, Varying,
+							   std::void_t<decltype(std::declval<Shader &>().vertexShader(
+								   std::declval<const VertexAttrib &>(), 0u, 0u, std::declval<Varying *>()))>>
+	: std::true_type
+{
+};
+
+// Verdadeiro se o shader tem a versão do fragmentShader com as derivadas dos varyings na tela:
+// fragmentShader(v, dvdx, dvdy, cor), usada por exemplo para escolher o nível de mipmap (Sampler2D.h)
+template <class Shader, class Varying, class Color, class = void>
+struct has_derivative_fragment_shader : std::false_type
+{
+};
+
+template <class Shader, class Varying, class Color>
+struct has_derivative_fragment_shader<Shader, Varying, Color,
+									  std::void_t<decltype(std::declval<Shader &>().fragmentShader(
+										  std::declval<Varying>(), std::declval<Varying>(), std::declval<Varying>(),
+										  std::declval<Color>()))>>
+	: std::true_type
+{
+};
+
+// Verdadeiro se o shader tem a versão em lote do fragmentShader:
+// fragmentShader(v, n, out) sombreia os fragmentos v[0], ..., v[n-1] (n <= 8) nas cores *out[i]
+template <class Shader, class Varying, class Color, class = void>
+struct has_batch_fragment_shader : std::false_type
+{
+};
+
+template <class Shader, class Varying, class Color>
+struct has_batch_fragment_shader<Shader, Varying, Color,
+								 std::void_t<decltype(std::declval<Shader &>().fragmentShader(
+									 std::declval<const Varying *>(), 0u,
+									 std::declval<std::remove_reference_t<Color> *const *>()))>>
+	: std::true_type
+{
+};
 
 template <class VertexAttrib, class Prims, class Shader, class ImageType>
 struct Render3D
 {
 	using Varying = typename Shader::Varying;
+	using Indices = decltype(std::declval<const Prims &>().assemble(0, VertexIndices{}));
+	using Primitive = std::array<Varying, std::tuple_size<Indices>::value>;
+
+	// com várias amostras por pixel (Multisample.h), o fragmentShader roda uma vez por pixel
+	// e a cor vai para as amostras cobertas que passaram no teste de profundidade
+	static constexpr bool multisample = is_multisample_image<ImageType>::value;
+
+	// o shader transforma vários vértices seguidos de uma vez (SoA.h)
+	static constexpr bool batch_vertex_shader = has_batch_vertex_shader<Shader, VertexAttrib, Varying>::value;
 
 	Shader &shader;
 	ImageType &image;
+	PixelRect bounds; // só os pixels dentro de bounds são pintados
+	Culling culling;
+	ThreadProfile *profile = profiling(); // medição desta thread, se ligada (Profiler.h)
 
-	Render3D(const VertexAttrib &V, const Prims &p, Shader &shader, ImageType &image)
-		: shader{shader}, image{image}
+	// visibility: posição das primitivas em relação ao volume de visão, se já conhecida
+	// (frustumTest de uma caixa envolvente, BoundingBox.h)
+	Render3D(const VertexAttrib &V, const Prims &p, Shader &shader, ImageType &image,
+			 FrustumTest visibility = FRUSTUM_INTERSECTS, Culling culling = {})
+		: Render3D{shader, image, {0, 0, image.width(), image.height()}, culling}
 	{
+		if (visibility == FRUSTUM_OUTSIDE)
+			return;
+
+		ProfileEvent event{profile, "Render3D"};
+		if (profile)
+			pipelineProfiler().target(image.width(), image.height());
+
 		// Pipeline de renderização
-		for (auto primitive : clip(assemble(p, transform(V))))
-			draw(primitive);
+		forEachBatch(V, p, batch_size, [&](const auto &primitives)
+		{
+			for (const auto &primitive : primitives)
+			{
+				ProfileStage stage{profile, STAGE_CLIP};
+				if (culledBeforeClip(primitive))
+					continue;
+				else if (visibility == FRUSTUM_INSIDE)
+					draw(primitive);
+				else
+					clip(primitive, [&](const auto &clipped) { draw(clipped); });
+			}
+		});
+	}
+
+	// Não desenha nada: usado para desenhar primitivas já recortadas em uma região da imagem
+	Render3D(Shader &shader, ImageType &image)
+		: Render3D{shader, image, {0, 0, image.width(), image.height()}}
+	{
+	}
+
+	Render3D(Shader &shader, ImageType &image, PixelRect bounds, Culling culling = {})
+		: shader{shader}, image{image}, bounds{bounds}, culling{culling}
+	{
+	}
+
+	// descarte pela orientação antes do recorte (culling.before_clip); linhas nunca são descartadas
+	template <class P>
+	bool culledBeforeClip(const P &primitive) const
+	{
+		if constexpr (std::tuple_size<P>::value == 3)
+			return culling.before_clip &&
+				   countCulled(culled(culling.face, clipSpaceArea(primitive[0].position, primitive[1].position,
+																  primitive[2].position)));
+		else
+			return false;
+	}
+
+	// descarte pela orientação depois do recorte, pela área na tela
+	template <class P>
+	bool culledOnScreen(const P &primitive) const
+	{
+		if constexpr (std::tuple_size<P>::value == 3)
+			return !culling.before_clip &&
+				   countCulled(culled(culling.face, tri_area(toScreen(primitive[0].position),
+															 toScreen(primitive[1].position),
+															 toScreen(primitive[2].position))));
+		else
+			return false;
+	}
+
+	bool countCulled(bool c) const
+	{
+		if (c && profile)
+			profile->counters.primitives_culled++;
+		return c;
 	}
 
 	std::vector<Varying> transform(const VertexAttrib &V)
 	{
 		std::vector<Varying> PV(std::size(V));
-		for (unsigned int i = 0; i < std::size(V); i++)
-			shader.vertexShader(V[i], PV[i]);
+		shade(V, 0, PV.size(), PV.data());
 		return PV;
 	}
 
+	// vertexShader dos vértices first, ..., first+n-1 de V; usa a versão em lote do shader, se houver
+	void shade(const VertexAttrib &V, unsigned int first, unsigned int n, Varying *out)
+	{
+		ProfileStage stage{profile, STAGE_VERTEX};
+		if constexpr (batch_vertex_shader)
+			shader.vertexShader(V, first, n, out);
+		else
+			for (unsigned int i = 0; i < n; i++)
+				shader.vertexShader(V[first + i], out[i]);
+	}
+
+	// primitivas processadas por lote: os vértices transformados de um lote cabem na cache L2
+	static constexpr unsigned int batch_size = 256;
+
+	// Monta as primitivas de p em lotes de até n primitivas e chama f(primitivas) para cada lote.
+	// Só os vértices usados pelo lote passam pelo vertexShader, cada um uma única vez por lote.
+	// Os buffers são reaproveitados: a memória usada é proporcional a n, não à malha.
+	template <class F>
+	void forEachBatch(const VertexAttrib &V, const Prims &p, unsigned int n, F f)
+	{
+		std::vector<Indices> batch;
+		std::vector<Varying> PV;
+		UniqueIndices unique;
+		std::conditional_t<batch_vertex_shader, VertexAttrib, std::nullptr_t> gathered{}; // atributos de unique
+		std::vector<Primitive> primitives;
+
+		for (size_t first = 0; first < p.size(); first += n)
+		{
+			size_t last = std::min(first + n, p.size());
+
+			ProfileStage stage{profile, STAGE_ASSEMBLE};
+			batch.clear();
+			unsigned int vmin = UINT_MAX, vmax = 0;
+			for (size_t i = first; i < last; i++)
+			{
+				batch.push_back(p.assemble(i, VertexIndices{}));
+				for (unsigned int v : batch.back())
+				{
+					vmin = std::min(vmin, v);
+					vmax = std::max(vmax, v);
+				}
+			}
+
+			primitives.resize(batch.size());
+			if (vmax - vmin < batch.size() * std::size(batch[0]))
+			{
+				// índices contíguos (Triangles, TriangleStrip, ...): transforma o intervalo todo
+				PV.resize(vmax - vmin + 1);
+				shade(V, vmin, PV.size(), PV.data());
+
+				for (unsigned int i = 0; i < batch.size(); i++)
+					for (unsigned int k = 0; k < std::size(batch[i]); k++)
+						primitives[i][k] = PV[batch[i][k] - vmin];
+			}
+			else
+			{
+				// índices espalhados (Elements, TriangleFan): cada índice distinto é transformado uma vez;
+				// batch passa a guardar as posições dos vértices em PV
+				unique.clear(batch.size() * std::size(batch[0]));
+				for (Indices &indices : batch)
+					for (unsigned int &v : indices)
+						v = unique.insert(v);
+
+				const std::vector<unsigned int> &U = unique.indices;
+				PV.resize(U.size());
+				if constexpr (batch_vertex_shader)
+				{
+					// a versão em lote do vertexShader lê vértices seguidos: copia os atributos antes
+					gathered.clear();
+					for (unsigned int v : U)
+						gathered.push_back(V[v]);
+					shade(gathered, 0, U.size(), PV.data());
+				}
+				else
+				{
+					ProfileStage vertex{profile, STAGE_VERTEX};
+					for (unsigned int i = 0; i < U.size(); i++)
+						shader.vertexShader(V[U[i]], PV[i]);
+				}
+
+				for (unsigned int i = 0; i < batch.size(); i++)
+					for (unsigned int k = 0; k < std::size(batch[i]); k++)
+						primitives[i][k] = PV[batch[i][k]];
+			}
+
+			if (profile)
+				profile->counters.primitives_in += batch.size();
+			stage.stop();
+
+			f(primitives);
+		}
+	}
+
 	void draw(Line<Varying> line)
 	{
+		ProfileStage setup{profile, STAGE_SETUP};
+		if (profile)
+			profile->counters.primitive_setups++;
+
 		vec4 P[] = {line[0].position, line[1].position};
 		vec2 L[] = {toScreen(P[0]), toScreen(P[1])};
+		float z[] = {P[0][2] / P[0][3], P[1][2] / P[1][3]};
 
-		for (Pixel p : rasterizeLine(L))
+		ProfileStage raster{profile, STAGE_RASTER};
+		rasterizeLine(L, [&](Pixel p)
 		{
+			if (!bounds.has(p))
+				return;
+
 			float t = find_mix_param(toVec2(p), L[0], L[1]);
+			unsigned int coverage = 1;
+			if constexpr (multisample)
+				coverage = sampleDepth(p, (1 - t) * z[0] + t * z[1], 0, 0, (1u << image.samples()) - 1);
+			else
+				coverage = earlyDepth(p, (1 - t) * z[0] + t * z[1], DEPTH_TEST);
+			if (!coverage)
+				return;
+
 			Varying vi;
-			asVec(vi) = (1 - t) * asVec(line[0]) + t * asVec(line[1]);
-			paint(p, vi);
-		}
+			{
+				ProfileStage stage{profile, STAGE_FRAGMENT};
+				asVec(vi) = (1 - t) * asVec(line[0]) + t * asVec(line[1]);
+			}
+			paint(p, vi, coverage);
+		});
 	}
 
 	void draw(Triangle<Varying> tri)
 	{
+		ProfileStage setup{profile, STAGE_SETUP};
 		vec4 P[] = {tri[0].position, tri[1].position, tri[2].position};
 		vec2 T[] = {toScreen(P[0]), toScreen(P[1]), toScreen(P[2])};
+		if (!culling.before_clip && countCulled(culled(culling.face, tri_area(T[0], T[1], T[2]))))
+			return;
+		if (profile)
+			profile->counters.primitive_setups++;
+
 		vec3 iw = {1 / P[0][3], 1 / P[1][3], 1 / P[2][3]}; // correção de perspectiva
 
-		for (Pixel p : rasterizeTriangle(T))
+		// z/w é afim na tela: testa a profundidade antes da correção de perspectiva
+		vec3 z = {P[0][2] * iw[0], P[1][2] * iw[1], P[2][2] * iw[2]};
+		DepthPlane depth{T, z};
+		PixelRect R = {
+			std::max(bounds.x0, (int)floor(std::min({T[0][0], T[1][0], T[2][0]}))),
+			std::max(bounds.y0, (int)floor(std::min({T[0][1], T[1][1], T[2][1]}))),
+			std::min(bounds.x1, (int)ceil(std::max({T[0][0], T[1][0], T[2][0]})) + 1),
+			std::min(bounds.y1, (int)ceil(std::max({T[0][1], T[1][1], T[2][1]})) + 1)};
+		if (!earlyTriangleTest(image, R, depth.zmin))
+			return;
+
+		DepthTest block_test = DEPTH_TEST;
+		auto block = [&](PixelRect B)
+		{
+			ProfileStage stage{profile, STAGE_DEPTH};
+			auto [zmin, zmax] = depth.range(B);
+			block_test = earlyBlockTest(image, B, zmin, zmax);
+			return block_test != DEPTH_CULL;
+		};
+
+		auto interpolate = [&](vec3 t)
 		{
-			vec3 t = barycentric_coords(toVec2(p), T);
+			ProfileStage stage{profile, STAGE_FRAGMENT};
 			t = t * iw;							// correção de perspectiva
 			t = 1.0 / (t[0] + t[1] + t[2]) * t; // correção de perspectiva
 			Varying vi;
 			asVec(vi) = t[0] * asVec(tri[0]) + t[1] * asVec(tri[1]) + t[2] * asVec(tri[2]);
-			paint(p, vi);
+			return vi;
+		};
+
+		// Chama f(p, t, coverage) para cada pixel que passa no teste de profundidade antecipado.
+		// Com multiamostragem, coverage são as amostras do pixel cobertas e na frente; senão, 1.
+		auto rasterize = [&](auto f)
+		{
+			ProfileStage raster{profile, STAGE_RASTER};
+			if constexpr (multisample)
+				rasterizeTriangleSamples(T, bounds, image.samplePattern(), [&](Pixel p, vec3 t, unsigned int coverage)
+				{
+					coverage = sampleDepth(p, t[0] * z[0] + t[1] * z[1] + t[2] * z[2], depth.a, depth.b, coverage);
+					if (coverage)
+						f(p, t, coverage);
+				}, block);
+			else
+				rasterizeTriangle(T, bounds, [&](Pixel p, vec3 t)
+				{
+					if (earlyDepth(p, t[0] * z[0] + t[1] * z[1] + t[2] * z[2], block_test))
+						f(p, t, 1u);
+				}, block);
+		};
+
+		using Color = decltype(image(0, 0));
+		if constexpr (has_derivative_fragment_shader<Shader, Varying, Color>::value)
+		{
+			// Derivadas dos varyings calculadas uma vez por quad 2x2 de pixels, como na GPU:
+			// diferenças entre o pixel par do quad e seus vizinhos em x e em y.
+			// As coordenadas baricêntricas (antes da correção de perspectiva) são afins na tela.
+			vec2 e1 = T[1] - T[0], e2 = T[2] - T[0];
+			float det = e1[0] * e2[1] - e2[0] * e1[1];
+			vec3 dtdx = {(e1[1] - e2[1]) / det, e2[1] / det, -e1[1] / det};
+			vec3 dtdy = {(e2[0] - e1[0]) / det, -e2[0] / det, e1[0] / det};
+
+			struct QuadDerivatives
+			{
+				int x = INT_MIN, y = INT_MIN;
+				Varying dx, dy;
+			};
+			QuadDerivatives quads[8]; // quads de uma linha de um bloco do rasterizador
+
+			rasterize([&](Pixel p, vec3 t, unsigned int coverage)
+			{
+				int qx = p.x & ~1, qy = p.y & ~1;
+				QuadDerivatives &q = quads[(qx >> 1) & 7];
+				if (q.x != qx || q.y != qy)
+				{
+					vec3 t0 = t + (float)(qx - p.x) * dtdx + (float)(qy - p.y) * dtdy;
+					Varying v0 = interpolate(t0);
+					asVec(q.dx) = asVec(interpolate(t0 + dtdx)) - asVec(v0);
+					asVec(q.dy) = asVec(interpolate(t0 + dtdy)) - asVec(v0);
+					q.x = qx;
+					q.y = qy;
+				}
+				paint(p, interpolate(t), q.dx, q.dy, coverage);
+			});
+			return;
+		}
+
+		if constexpr (has_batch_fragment_shader<Shader, Varying, Color>::value)
+		{
+			// Fragmentos que passam em testPixel são sombreados de 8 em 8.
+			// Os pixels de um triângulo são distintos, então adiar a escrita não muda o resultado.
+			// Com multiamostragem, as cores vão para shaded e depois para as amostras.
+			Varying V[8];
+			std::remove_reference_t<Color> *out[8], shaded[8];
+			Pixel pixels[8];
+			unsigned int masks[8];
+			unsigned int n = 0;
+			auto shadeBatch = [&]
+			{
+				ProfileStage stage{profile, STAGE_FRAGMENT};
+				shader.fragmentShader(V, n, out);
+				if constexpr (multisample)
+					for (unsigned int i = 0; i < n; i++)
+						image.writeSamples(pixels[i], masks[i], shaded[i]);
+				n = 0;
+			};
+
+			rasterize([&](Pixel p, vec3 t, unsigned int coverage)
+			{
+				V[n] = interpolate(t);
+				if (!depthTest(p, V[n]))
+					return;
+
+				if constexpr (multisample)
+				{
+					out[n] = &shaded[n];
+					pixels[n] = p;
+					masks[n] = coverage;
+				}
+				else
+					out[n] = &image(p.x, p.y);
+				written(p);
+				if (++n == 8)
+					shadeBatch();
+			});
+			if (n > 0)
+				shadeBatch();
+			return;
 		}
+
+		rasterize([&](Pixel p, vec3 t, unsigned int coverage) { paint(p, interpolate(t), coverage); });
 	}
 
 	vec2 toScreen(vec4 P) const
@@ -72,10 +531,84 @@ struct Render3D
 			((y / w + 1) * image.height() - 1) / 2};
 	}
 
-	void paint(Pixel p, Varying v)
+	// coverage: amostras do pixel que recebem a cor, com multiamostragem
+	void paint(Pixel p, Varying v, unsigned int coverage = 1)
+	{
+		if (depthTest(p, v))
+		{
+			ProfileStage stage{profile, STAGE_FRAGMENT};
+			if constexpr (multisample)
+			{
+				std::remove_reference_t<decltype(image(0, 0))> color{};
+				shader.fragmentShader(v, color);
+				image.writeSamples(p, coverage, color);
+			}
+			else
+				shader.fragmentShader(v, image(p.x, p.y));
+			written(p);
+		}
+	}
+
+	void paint(Pixel p, Varying v, const Varying &dvdx, const Varying &dvdy, unsigned int coverage = 1)
+	{
+		if (depthTest(p, v))
+		{
+			ProfileStage stage{profile, STAGE_FRAGMENT};
+			if constexpr (multisample)
+			{
+				std::remove_reference_t<decltype(image(0, 0))> color{};
+				shader.fragmentShader(v, dvdx, dvdy, color);
+				image.writeSamples(p, coverage, color);
+			}
+			else
+				shader.fragmentShader(v, dvdx, dvdy, image(p.x, p.y));
+			written(p);
+		}
+	}
+
+	// earlyDepthTest e testPixel, com a contagem dos fragmentos (Profiler.h)
+	bool earlyDepth(Pixel p, float z, DepthTest mode)
+	{
+		ProfileStage stage{profile, STAGE_DEPTH};
+		bool pass = earlyDepthTest(image, p, z, mode);
+		if (profile)
+		{
+			profile->counters.fragments_generated++;
+			profile->counters.fragments_rejected += !pass;
+		}
+		return pass;
+	}
+
+	// teste de profundidade das amostras em coverage (multiamostragem), com a contagem dos fragmentos;
+	// z é a profundidade no centro do pixel e dzdx, dzdy suas derivadas na tela
+	unsigned int sampleDepth(Pixel p, float z, float dzdx, float dzdy, unsigned int coverage)
+	{
+		ProfileStage stage{profile, STAGE_DEPTH};
+		unsigned int pass = image.testSamples(p, z, dzdx, dzdy, coverage);
+		if (profile)
+		{
+			profile->counters.fragments_generated++;
+			profile->counters.fragments_rejected += !pass;
+		}
+		return pass;
+	}
+
+	bool depthTest(Pixel p, const Varying &v)
+	{
+		ProfileStage stage{profile, STAGE_DEPTH};
+		bool pass = testPixel(p, v, image);
+		if (profile)
+			profile->counters.fragments_rejected += !pass;
+		return pass;
+	}
+
+	void written(Pixel p)
 	{
-		if (testPixel(p, v, image))
-			shader.fragmentShader(v, image(p.x, p.y));
+		if (profile)
+		{
+			profile->counters.fragments_written++;
+			pipelineProfiler().written(p.x, p.y);
+		}
 	}
 };
 
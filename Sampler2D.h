@@ -1,36 +1,276 @@
 #ifndef SAMPLER2D_H
 #define SAMPLER2D_H
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 #include "Image.h"
+#include "Texture.h"
 
-enum Filter{NEAREST, BILINEAR};
+// TRILINEAR: bilinear nos dois níveis de mipmap mais próximos do tamanho do pixel
+enum Filter{NEAREST, BILINEAR, TRILINEAR};
 enum WrapMode{CLAMP, REPEAT, MIRRORED_REPEAT};
 
-class Sampler2D{
+// Filtro e modos de repetição de uma textura.
+// O Sampler2D tem a sua própria textura (img, herdada de Texture),
+// ou amostra, sem cópia, uma Texture ligada com bind (por exemplo, do TextureStore).
+class Sampler2D : public Texture{
 	public:
-	ImageRGB img;
 	Filter filter;
 	WrapMode wrapX, wrapY;
 	RGB default_color = magenta;
+	float max_anisotropy = 1; // máximo de amostras ao longo da maior direção do pixel na textura
 
 	RGB sample(vec2 texCoords) const{
-		if(img.width() == 0 || img.height() == 0)
+		const Texture& T = bound();
+		if(T.img.width() == 0 || T.img.height() == 0)
 			return default_color;
 
-		vec2 s = {
+		vec2 s = normalize(texCoords);
+		if(const TexelStorage* S = T.texels(0))
+			return filter==NEAREST? sampleNearest(*S, s): sampleBilinear(*S, s);
+		return filter==NEAREST? sampleNearest(T.img, s): sampleBilinear(T.img, s);
+	}
+
+	// Amostra a textura na área coberta por um pixel da tela.
+	// dx e dy são as derivadas de texCoords em relação a x e a y da tela.
+	// Com TRILINEAR o nível de mipmap é escolhido pelo tamanho do pixel na textura e,
+	// com max_anisotropy > 1, são tomadas várias amostras ao longo da maior direção.
+	RGB sample(vec2 texCoords, vec2 dx, vec2 dy) const{
+		const Texture& T = bound();
+		if(filter != TRILINEAR || T.levels() == 1)
+			return sample(texCoords);
+
+		// derivadas em texels
+		float lx = norm(vec2{dx[0]*T.img.width(), dx[1]*T.img.height()});
+		float ly = norm(vec2{dy[0]*T.img.width(), dy[1]*T.img.height()});
+		float pmax = std::max(lx, ly);
+		float pmin = std::min(lx, ly);
+		vec2 axis = lx > ly? dx: dy;
+		if(!(pmax < 1e30f)) // derivadas inválidas perto do horizonte
+			return sampleTrilinear(T, normalize(texCoords), T.levels()-1);
+
+		float ratio = pmax/std::max(pmin, 1e-6f);
+		int n = ratio < max_anisotropy? (int)ceil(ratio): std::max(1, (int)max_anisotropy);
+		float lod = log2(std::max(pmax/n, 1e-6f));
+
+		if(n == 1)
+			return sampleTrilinear(T, normalize(texCoords), lod);
+
+		int sum[3] = {0, 0, 0};
+		for(int i = 0; i < n; i++){
+			RGB c = sampleTrilinear(T, normalize(texCoords + ((i + 0.5f)/n - 0.5f)*axis), lod);
+			for(int k = 0; k < 3; k++)
+				sum[k] += channel(c, k);
+		}
+		RGB c;
+		for(int k = 0; k < 3; k++)
+			channel(c, k) = (sum[k] + n/2)/n;
+		return c;
+	}
+
+	// Passa a amostrar texture, sem copiá-la: texture deve existir enquanto estiver ligada.
+	// Com nullptr volta a amostrar a textura do próprio Sampler2D (img e seus mipmaps).
+	void bind(const Texture* texture){
+		view = texture;
+	}
+
+	// textura amostrada
+	const Texture& bound() const{
+		return view? *view: *this;
+	}
+
+	// Amostra até 8 coordenadas de uma vez: out[i] = sample({u[i], v[i]}), i = 0, ..., n-1.
+	// Filtro e modos de repetição são resolvidos uma vez por lote, e com AVX2 as coordenadas
+	// e os pesos bilineares são calculados nas 8 posições de um registrador.
+	// Como em sample(vec2), TRILINEAR usa o filtro bilinear no nível 0.
+	// As cores bilineares são arredondadas, e podem diferir ligeiramente das de bilerp.
+	void sample8(const float* u, const float* v, RGB* out, int n = 8) const{
+		const Texture& T = bound();
+		if(T.img.width() == 0 || T.img.height() == 0){
+			std::fill(out, out + n, default_color);
+			return;
+		}
+
+		float U[8], V[8];
+		for(int i = 0; i < 8; i++){
+			U[i] = u[i < n? i: 0];
+			V[i] = v[i < n? i: 0];
+		}
+
+		uint32_t result[8];
+		if(const TexelStorage* S = T.texels(0))
+			sampleBatch(*S, U, V, result);
+		else
+			sampleBatch(T.img, U, V, result);
+
+		for(int i = 0; i < n; i++)
+			memcpy(&out[i], &result[i], sizeof(RGB));
+	}
+
+	// Os 4 pixels de um quad 2x2
+	void sampleQuad(const vec2 texCoords[4], RGB out[4]) const{
+		float u[4], v[4];
+		for(int i = 0; i < 4; i++){
+			u[i] = texCoords[i][0];
+			v[i] = texCoords[i][1];
+		}
+		sample8(u, v, out, 4);
+	}
+
+	private:
+	const Texture* view = nullptr;
+
+	vec2 normalize(vec2 texCoords) const{
+		return {
 			normalizeValue(texCoords[0], wrapX),
 			normalizeValue(texCoords[1], wrapY),
-		};	
-
-		vec2 p = {
-			s[0]*img.width()  - 0.5f,
-			s[1]*img.height() - 0.5f
 		};
+	}
+
+	RGB sampleTrilinear(const Texture& T, vec2 s, float lod) const{
+		lod = clamp(lod, 0, T.levels()-1);
+		int l = floor(lod);
+		float t = lod - l;
 
-		return filter==NEAREST? sampleNearest(p): sampleBilinear(p);
+		RGB c = sampleBilinear(T, l, s);
+		if(t == 0 || l+1 >= T.levels())
+			return c;
+		return lerp(t, c, sampleBilinear(T, l+1, s));
 	}
 
-	private:
+	// escolhe a versão de sample8 para o filtro e os modos de repetição atuais
+	template<class Texels>
+	void sampleBatch(const Texels& T, const float* u, const float* v, uint32_t* out) const{
+		if(filter == NEAREST)
+			sampleBatch<NEAREST>(T, u, v, out);
+		else
+			sampleBatch<BILINEAR>(T, u, v, out);
+	}
+
+	template<Filter F, class Texels>
+	void sampleBatch(const Texels& T, const float* u, const float* v, uint32_t* out) const{
+		switch(wrapX){
+			case CLAMP:  return sampleBatch<F, CLAMP>(T, u, v, out);
+			case REPEAT: return sampleBatch<F, REPEAT>(T, u, v, out);
+			default:     return sampleBatch<F, MIRRORED_REPEAT>(T, u, v, out);
+		}
+	}
+
+	template<Filter F, WrapMode WX, class Texels>
+	void sampleBatch(const Texels& T, const float* u, const float* v, uint32_t* out) const{
+		switch(wrapY){
+			case CLAMP:  return sample8<F, WX, CLAMP>(T, u, v, out);
+			case REPEAT: return sample8<F, WX, REPEAT>(T, u, v, out);
+			default:     return sample8<F, WX, MIRRORED_REPEAT>(T, u, v, out);
+		}
+	}
+
+#if defined(__AVX2__)
+	template<WrapMode W>
+	static __m256 normalize8(__m256 v){
+		if(W == CLAMP)
+			return _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(1));
+
+		__m256 n = _mm256_floor_ps(v);
+		__m256 r = _mm256_sub_ps(v, n);
+		if(W == MIRRORED_REPEAT){
+			__m256 odd = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvttps_epi32(n), 31));
+			r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(1), r), odd);
+		}
+		return r;
+	}
+
+	// 8 texels (x[i], y[i]) em 4 bytes cada, como no TexelStorage.
+	// O ImageRGB guarda 3 bytes por texel: lê 4 bytes e descarta o último
+	// (o último texel da imagem é lido a partir do byte anterior, para não passar do fim).
+	static __m256i texels8(const ImageRGB& T, __m256i x, __m256i y){
+		__m256i i = _mm256_add_epi32(_mm256_mullo_epi32(y, _mm256_set1_epi32(T.width())), x);
+		__m256i last = _mm256_cmpeq_epi32(i, _mm256_set1_epi32(T.width()*T.height() - 1));
+		__m256i offset = _mm256_add_epi32(_mm256_add_epi32(i, i), _mm256_add_epi32(i, last));
+		__m256i t = _mm256_i32gather_epi32(reinterpret_cast<const int*>(T.data()), offset, 1);
+		t = _mm256_srlv_epi32(t, _mm256_and_si256(last, _mm256_set1_epi32(8)));
+		return _mm256_and_si256(t, _mm256_set1_epi32(0xFFFFFF));
+	}
+
+	static __m256i texels8(const TexelStorage& T, __m256i x, __m256i y){
+		return T.texels8(x, y);
+	}
+
+	// limitCoord nas 8 posições
+	template<WrapMode W>
+	static __m256i limit8(__m256i a, int len){
+		__m256i below = _mm256_cmpgt_epi32(_mm256_setzero_si256(), a);
+		__m256i above = _mm256_cmpgt_epi32(a, _mm256_set1_epi32(len-1));
+		a = _mm256_blendv_epi8(a, _mm256_set1_epi32(W == REPEAT? len-1: 0), below);
+		return _mm256_blendv_epi8(a, _mm256_set1_epi32(W == REPEAT? 0: len-1), above);
+	}
+
+	template<Filter F, WrapMode WX, WrapMode WY, class Texels>
+	static void sample8(const Texels& T, const float* u, const float* v, uint32_t* out){
+		int w = T.width(), h = T.height();
+		__m256 half = _mm256_set1_ps(0.5f);
+		__m256 px = _mm256_sub_ps(_mm256_mul_ps(normalize8<WX>(_mm256_loadu_ps(u)), _mm256_set1_ps(w)), half);
+		__m256 py = _mm256_sub_ps(_mm256_mul_ps(normalize8<WY>(_mm256_loadu_ps(v)), _mm256_set1_ps(h)), half);
+
+		if(F == NEAREST){
+			__m256i zero = _mm256_setzero_si256();
+			__m256i x = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_add_ps(px, half)));
+			__m256i y = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_add_ps(py, half)));
+			x = _mm256_min_epi32(_mm256_max_epi32(x, zero), _mm256_set1_epi32(w-1));
+			y = _mm256_min_epi32(_mm256_max_epi32(y, zero), _mm256_set1_epi32(h-1));
+			_mm256_storeu_si256((__m256i*)out, texels8(T, x, y));
+			return;
+		}
+
+		__m256 fx = _mm256_floor_ps(px), fy = _mm256_floor_ps(py);
+		__m256 a = _mm256_sub_ps(px, fx), b = _mm256_sub_ps(py, fy);
+		__m256i x = _mm256_cvttps_epi32(fx), y = _mm256_cvttps_epi32(fy);
+		__m256i one = _mm256_set1_epi32(1);
+
+		__m256i x0 = limit8<WX>(x, w), x1 = limit8<WX>(_mm256_add_epi32(x, one), w);
+		__m256i y0 = limit8<WY>(y, h), y1 = limit8<WY>(_mm256_add_epi32(y, one), h);
+		__m256i t[4] = {texels8(T, x0, y0), texels8(T, x1, y0), texels8(T, x0, y1), texels8(T, x1, y1)};
+
+		// pesos de bilerp(a, b, t[0], t[1], t[2], t[3])
+		__m256 ones = _mm256_set1_ps(1);
+		__m256 na = _mm256_sub_ps(ones, a), nb = _mm256_sub_ps(ones, b);
+		__m256 weight[4] = {_mm256_mul_ps(na, nb), _mm256_mul_ps(a, nb), _mm256_mul_ps(na, b), _mm256_mul_ps(a, b)};
+
+		__m256i mask = _mm256_set1_epi32(0xFF);
+		__m256i result = _mm256_setzero_si256();
+		for(int k = 0; k < 3; k++){
+			__m256 c = _mm256_setzero_ps();
+			for(int j = 0; j < 4; j++){
+				__m256i channel = _mm256_and_si256(_mm256_srli_epi32(t[j], 8*k), mask);
+				c = _mm256_add_ps(c, _mm256_mul_ps(weight[j], _mm256_cvtepi32_ps(channel)));
+			}
+			__m256i ck = _mm256_min_epi32(_mm256_cvtps_epi32(c), mask);
+			result = _mm256_or_si256(result, _mm256_slli_epi32(ck, 8*k));
+		}
+		_mm256_storeu_si256((__m256i*)out, result);
+	}
+#else
+	template<Filter F, WrapMode WX, WrapMode WY, class Texels>
+	void sample8(const Texels& T, const float* u, const float* v, uint32_t* out) const{
+		for(int i = 0; i < 8; i++){
+			vec2 s = {normalizeValue(u[i], WX), normalizeValue(v[i], WY)};
+			RGB c = F == NEAREST? sampleNearest(T, s): sampleBilinear(T, s);
+			out[i] = 0;
+			memcpy(&out[i], &c, sizeof(RGB));
+		}
+	}
+#endif
+
+	RGB sampleBilinear(const Texture& T, int l, vec2 s) const{
+		const TexelStorage* S = T.texels(l);
+		return S? sampleBilinear(*S, s): sampleBilinear(T.level(l), s);
+	}
 
 	float normalizeValue(float v, WrapMode mode) const{
 		if(mode == CLAMP)
@@ -45,13 +285,24 @@ class Sampler2D{
 		return r;		
 	}
 
-	RGB sampleNearest(vec2 p) const{
+	// Texels: ImageRGB ou TexelStorage
+	template<class Texels>
+	RGB sampleNearest(const Texels& img, vec2 s) const{
+		vec2 p = {
+			s[0]*img.width()  - 0.5f,
+			s[1]*img.height() - 0.5f
+		};
 		int x = clamp(round(p[0]), 0, img.width()-1);
 		int y = clamp(round(p[1]), 0, img.height()-1);
 		return img(x, y);
 	}
 		
-	RGB sampleBilinear(vec2 p) const{
+	template<class Texels>
+	RGB sampleBilinear(const Texels& img, vec2 s) const{
+		vec2 p = {
+			s[0]*img.width()  - 0.5f,
+			s[1]*img.height() - 0.5f
+		};
 		int x = floor(p[0]);
 		int y = floor(p[1]);
 		float u = p[0] - x;
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "TiledRender3D.h"
+#include "HiZBuffer.h"
+#include "Multisample.h"
+#include "TextureLODShader.h"
+#include "MeshCache.h"
+#include "transforms.h"
+#include "TextureStore.h"
+
+// Malha OBJ (do cache binário) com as texturas dos materiais, desenhada com o TextureLODShader.
+// Usada pelo bonecosglfw e pelo bonecosheadless.
+class Mesh
+{
+	CachedObjMesh mesh;
+	std::vector<MaterialRange> materials;
+	std::vector<std::shared_ptr<const Texture>> textures; // do TextureStore, compartilhadas entre as malhas
+	std::vector<Sampler2D> samplers;					   // um por material
+	std::vector<unsigned int> roots;					   // BVH dos clusters de cada material
+	AABB box;											   // da malha inteira
+
+public:
+	mat4 Model;
+	CullFace cull = CULL_NONE; // CULL_BACK só para malhas fechadas
+
+	Mesh(std::string obj_file, mat4 _Model, std::string default_texture = "", CullFace cull = CULL_NONE)
+		: mesh{obj_file}, cull{cull}
+	{
+		MaterialInfo std_mat;
+		std_mat.map_Kd = default_texture;
+
+		materials = mesh.getMaterials(std_mat);
+		roots = mesh.getBVHRoots();
+
+		// como no bonecosgl: GL_LINEAR_MIPMAP_LINEAR com anisotropia
+		for (MaterialRange range : materials)
+		{
+			std::string file = range.mat.map_Kd.empty() ? "" : mesh.path + range.mat.map_Kd;
+			textures.push_back(defaultTextureStore().load(file));
+
+			Sampler2D &sampler = samplers.emplace_back();
+			sampler.bind(textures.back().get());
+			sampler.filter = TRILINEAR;
+			sampler.wrapX = REPEAT;
+			sampler.wrapY = REPEAT;
+			sampler.max_anisotropy = 16;
+
+			box.add(mesh.getBVHNodes()[roots[samplers.size() - 1]].box);
+		}
+
+		Model = _Model;
+	}
+
+	// G: ImageHiZBuffer ou, com multiamostragem, ImageMultisample
+	template <class ImageType>
+	void draw(ImageType &G, TextureLODShader &shader) const
+	{
+		// malhas e clusters fora da tela não passam pelo vertexShader;
+		// os que estão inteiros dentro da tela não são recortados
+		if (frustumTest(shader.M, box) == FRUSTUM_OUTSIDE)
+			return;
+
+		std::vector<ClusterRange> visible;
+		for (size_t i = 0; i < materials.size(); i++)
+		{
+			// com CULL_BACK, os clusters inteiros de costas nem são percorridos
+			visible.clear();
+			cullClusters(mesh.getBVHNodes(), mesh.getClusters(), roots[i], shader.M, cull == CULL_BACK, visible);
+
+			shader.texture = &samplers[i];
+			for (const ClusterRange &r : visible)
+				TiledRender3D(mesh.getTriangles(), TrianglesRange{r.first, r.count}, shader, G, r.visibility, {cull});
+		}
+	}
+};
+
+// a cena dos programas: chão, carro, casa, Luigi e Mario
+inline void loadScene(std::vector<Mesh> &meshes)
+{
+	meshes.emplace_back(
+		"modelos/floor.obj",
+		scale(35, 35, 35),
+		"../stone.jpg");
+
+	meshes.emplace_back(
+		"modelos/carro/carro.obj",
+		translate(-1, 0.6, 2) * scale(1, 1, 1));
+
+	meshes.emplace_back(
+		"modelos/luigi/Luigi.obj",
+		translate(1, 0, 0) * scale(0.6, 0.6, 0.6),
+		"", CULL_BACK);
+
+	meshes.emplace_back(
+		"modelos/House Complex/House Complex.obj",
+		translate(4, 0, 0) * rotate_y(0.5 * M_PI) * scale(.15, .15, .15));
+
+	meshes.emplace_back(
+		"modelos/mario/Mario.obj",
+		translate(-2, 0, -3) * scale(0.6, 0.6, 0.6),
+		"", CULL_BACK);
+}
+
+// Desenha as malhas com a câmera ProjectionView em I, que já deve estar limpo.
+// O shader é reaproveitado: só M e a textura mudam de uma malha para outra.
+template <class ImageType>
+void drawScene(const std::vector<Mesh> &meshes, const mat4 &ProjectionView, ImageType &I, TextureLODShader &shader)
+{
+	for (const Mesh &mesh : meshes)
+	{
+		shader.M = ProjectionView * mesh.Model;
+		mesh.draw(I, shader);
+	}
+}
@@ -4,6 +4,7 @@
 #include "matrix.h"
 #include "Color.h"
 #include "VertexUtils.h"
+#include "SoA.h"
 
 struct SimpleShader{
 	struct Varying{
@@ -18,6 +19,11 @@ struct SimpleShader{
 		out.position = M*getPosition(in);
 	}
 
+	// versão em lote, 8 vértices por vez
+	void vertexShader(const VertexArraySoA& V, unsigned int first, unsigned int n, Varying* out){
+		transformPositions(M, V, first, n, out);
+	}
+
 	void fragmentShader(Varying, RGB& fragColor){
 		fragColor = C;
 	}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+#include "vec.h"
+#include "matrix.h"
+
+// Alocador com alinhamento de Align bytes, para carregar 8 floats de uma vez com AVX
+template <class T, size_t Align = 32>
+struct AlignedAllocator
+{
+	using value_type = T;
+
+	template <class U>
+	struct rebind
+	{
+		using other = AlignedAllocator<U, Align>;
+	};
+
+	AlignedAllocator() = default;
+
+	template <class U>
+	AlignedAllocator(const AlignedAllocator<U, Align> &) {}
+
+	T *allocate(size_t n)
+	{
+		return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t{Align}));
+	}
+
+	void deallocate(T *p, size_t)
+	{
+		::operator delete(p, std::align_val_t{Align});
+	}
+
+	template <class U>
+	bool operator==(const AlignedAllocator<U, Align> &) const { return true; }
+
+	template <class U>
+	bool operator!=(const AlignedAllocator<U, Align> &) const { return false; }
+};
+
+template <class T>
+using aligned_vector = std::vector<T, AlignedAllocator<T>>;
+
+// Posições de vértices em estrutura de arrays (SoA): as coordenadas x, y e z
+// ficam em arrays alinhados separados, prontos para serem processados 8 a 8.
+// V[i] devolve a posição como vec3, então os shaders comuns também funcionam.
+struct VertexArraySoA
+{
+	aligned_vector<float> x, y, z;
+
+	VertexArraySoA() = default;
+
+	explicit VertexArraySoA(const std::vector<vec3> &P)
+	{
+		reserve(P.size());
+		for (vec3 p : P)
+			push_back(p);
+	}
+
+	size_t size() const { return x.size(); }
+
+	vec3 operator[](size_t i) const { return {x[i], y[i], z[i]}; }
+
+	void reserve(size_t n)
+	{
+		x.reserve(n);
+		y.reserve(n);
+		z.reserve(n);
+	}
+
+	void clear()
+	{
+		x.clear();
+		y.clear();
+		z.clear();
+	}
+
+	void push_back(vec3 p)
+	{
+		x.push_back(p[0]);
+		y.push_back(p[1]);
+		z.push_back(p[2]);
+	}
+};
+
+// out[i].position = M*(x, y, z, 1) para os vértices first, ..., first+n-1 de V.
+// Com AVX transforma 8 vértices por vez, com cada coluna de M espalhada nas 8 posições.
+template <class Varying>
+void transformPositions(const mat4 &M, const VertexArraySoA &V, unsigned int first, unsigned int n, Varying *out)
+{
+	// colunas de M
+	vec4 C[4] = {M * vec4{1, 0, 0, 0}, M * vec4{0, 1, 0, 0}, M * vec4{0, 0, 1, 0}, M * vec4{0, 0, 0, 1}};
+
+	const float *X = V.x.data() + first;
+	const float *Y = V.y.data() + first;
+	const float *Z = V.z.data() + first;
+
+	unsigned int i = 0;
+#if defined(__AVX__)
+	__m256 c[4][4];
+	for (int j = 0; j < 4; j++)
+		for (int r = 0; r < 4; r++)
+			c[j][r] = _mm256_set1_ps(C[j][r]);
+
+	alignas(32) float lanes[4][8];
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(X + i);
+		__m256 y = _mm256_loadu_ps(Y + i);
+		__m256 z = _mm256_loadu_ps(Z + i);
+		for (int r = 0; r < 4; r++)
+		{
+			__m256 xy = _mm256_add_ps(_mm256_mul_ps(c[0][r], x), _mm256_mul_ps(c[1][r], y));
+			__m256 zw = _mm256_add_ps(_mm256_mul_ps(c[2][r], z), c[3][r]);
+			_mm256_store_ps(lanes[r], _mm256_add_ps(xy, zw));
+		}
+
+		for (int k = 0; k < 8; k++)
+			out[i + k].position = {lanes[0][k], lanes[1][k], lanes[2][k], lanes[3][k]};
+	}
+#endif
+	for (; i < n; i++)
+	{
+		vec4 &p = out[i].position;
+		for (int r = 0; r < 4; r++)
+			p[r] = (C[0][r] * X[i] + C[1][r] * Y[i]) + (C[2][r] * Z[i] + C[3][r]);
+	}
+}
@@ -0,0 +1,136 @@
+#ifndef TEXEL_STORAGE_H
+#define TEXEL_STORAGE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include "Image.h"
+
+// Organização dos texels de uma textura na memória
+enum TexelLayout{
+	ROW_MAJOR, // linha a linha, como o ImageRGB
+	TILED_4x4, // blocos de 4x4 texels (64 bytes, uma linha de cache), blocos linha a linha
+	MORTON     // ordem de Morton (curva Z) em quadrados de lado potência de 2
+};
+
+// Texels de uma imagem com 4 bytes cada (RGB e um byte de preenchimento), na organização escolhida.
+// Em blocos, os 4 texels de uma amostra bilinear quase sempre ficam na mesma linha de cache,
+// qualquer que seja a direção em que a textura é percorrida.
+// A conversão é feita uma vez, ao carregar a textura.
+class TexelStorage{
+	static_assert(sizeof(RGB) <= sizeof(uint32_t), "um texel deve caber em 4 bytes");
+
+	int w = 0, h = 0;
+	TexelLayout layout = ROW_MAJOR;
+	int shift = 0;       // MORTON: lado dos quadrados = 2^shift
+	unsigned stride = 0; // blocos (ou quadrados) por linha
+	std::vector<uint32_t> texels;
+
+	public:
+	TexelStorage() = default;
+
+	TexelStorage(const ImageRGB& img, TexelLayout layout) :
+		w{img.width()}, h{img.height()}, layout{layout}
+	{
+		size_t size = (size_t)w*h;
+		if(layout == TILED_4x4){
+			stride = (w + 3)/4;
+			size = (size_t)stride*((h + 3)/4)*16;
+		}else if(layout == MORTON){
+			// maior potência de 2 que cabe nas duas dimensões
+			while((2 << shift) <= std::min(w, h))
+				shift++;
+			int side = 1 << shift;
+			stride = (w + side - 1) >> shift;
+			size = (size_t)stride*((h + side - 1) >> shift) << 2*shift;
+		}
+
+		texels.assign(size, 0);
+		for(int y = 0; y < h; y++)
+			for(int x = 0; x < w; x++)
+				memcpy(&texels[index(x, y)], &img(x, y), sizeof(RGB));
+	}
+
+	int width() const{ return w; }
+	int height() const{ return h; }
+	TexelLayout getLayout() const{ return layout; }
+	size_t memory() const{ return texels.size()*sizeof(uint32_t); }
+
+	// texel (x, y) com os 4 bytes: RGB nos primeiros, 0 no último
+	uint32_t texel(int x, int y) const{
+		return texels[index(x, y)];
+	}
+
+	RGB operator()(int x, int y) const{
+		RGB c;
+		memcpy(&c, &texels[index(x, y)], sizeof(RGB));
+		return c;
+	}
+
+	size_t index(int x, int y) const{
+		if(layout == TILED_4x4)
+			return ((size_t)(y >> 2)*stride + (x >> 2))*16 + (y & 3)*4 + (x & 3);
+
+		if(layout == MORTON){
+			unsigned mask = (1u << shift) - 1;
+			size_t square = (size_t)(y >> shift)*stride + (x >> shift);
+			return square << 2*shift | interleave(x & mask) | interleave(y & mask) << 1;
+		}
+
+		return (size_t)y*w + x;
+	}
+
+#if defined(__AVX2__)
+	// os 8 texels (x[i], y[i])
+	__m256i texels8(__m256i x, __m256i y) const{
+		return _mm256_i32gather_epi32(reinterpret_cast<const int*>(texels.data()), index8(x, y), 4);
+	}
+
+	__m256i index8(__m256i x, __m256i y) const{
+		if(layout == TILED_4x4){
+			__m256i three = _mm256_set1_epi32(3);
+			__m256i tile = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(y, 2), _mm256_set1_epi32(stride)),
+				_mm256_srli_epi32(x, 2));
+			__m256i inside = _mm256_add_epi32(_mm256_slli_epi32(_mm256_and_si256(y, three), 2), _mm256_and_si256(x, three));
+			return _mm256_add_epi32(_mm256_slli_epi32(tile, 4), inside);
+		}
+
+		if(layout == MORTON){
+			__m256i mask = _mm256_set1_epi32((1 << shift) - 1);
+			__m256i square = _mm256_add_epi32(
+				_mm256_mullo_epi32(_mm256_srli_epi32(y, shift), _mm256_set1_epi32(stride)), _mm256_srli_epi32(x, shift));
+			__m256i z = _mm256_or_si256(interleave8(_mm256_and_si256(x, mask)),
+				_mm256_slli_epi32(interleave8(_mm256_and_si256(y, mask)), 1));
+			return _mm256_or_si256(_mm256_sll_epi32(square, _mm_cvtsi32_si128(2*shift)), z);
+		}
+
+		return _mm256_add_epi32(_mm256_mullo_epi32(y, _mm256_set1_epi32(w)), x);
+	}
+#endif
+
+	private:
+#if defined(__AVX2__)
+	static __m256i interleave8(__m256i v){
+		v = _mm256_and_si256(_mm256_or_si256(v, _mm256_slli_epi32(v, 8)), _mm256_set1_epi32(0x00FF00FF));
+		v = _mm256_and_si256(_mm256_or_si256(v, _mm256_slli_epi32(v, 4)), _mm256_set1_epi32(0x0F0F0F0F));
+		v = _mm256_and_si256(_mm256_or_si256(v, _mm256_slli_epi32(v, 2)), _mm256_set1_epi32(0x33333333));
+		v = _mm256_and_si256(_mm256_or_si256(v, _mm256_slli_epi32(v, 1)), _mm256_set1_epi32(0x55555555));
+		return v;
+	}
+#endif
+
+	// espalha os 16 bits de v nos bits pares do resultado
+	static uint32_t interleave(uint32_t v){
+		v = (v | v << 8) & 0x00FF00FF;
+		v = (v | v << 4) & 0x0F0F0F0F;
+		v = (v | v << 2) & 0x33333333;
+		v = (v | v << 1) & 0x55555555;
+		return v;
+	}
+};
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <algorithm>
+#include <vector>
+#include "Image.h"
+#include "TexelStorage.h"
+
+// Texels de uma textura: a imagem, seus mipmaps e, opcionalmente,
+// cópias de todos os níveis em outra organização na memória (TexelStorage).
+// O filtro e os modos de repetição ficam no Sampler2D, que pode amostrar uma Texture compartilhada.
+class Texture{
+	public:
+	ImageRGB img;
+
+	Texture() = default;
+	explicit Texture(ImageRGB img) : img{std::move(img)} {}
+
+	// Gera a cadeia de mipmaps de img, usada pelo filtro TRILINEAR:
+	// cada nível tem a metade do tamanho do anterior, até 1x1.
+	// Deve ser chamada de novo sempre que img mudar.
+	void generateMipmaps(){
+		mipmaps.clear();
+		storage.clear();
+		while(true){
+			const ImageRGB& prev = level(mipmaps.size());
+			if(prev.width() <= 1 && prev.height() <= 1)
+				break;
+
+			int w = std::max(1, prev.width()/2);
+			int h = std::max(1, prev.height()/2);
+			ImageRGB next{w, h};
+			for(int y = 0; y < h; y++){
+				int y0 = std::min(2*y, prev.height()-1), y1 = std::min(2*y+1, prev.height()-1);
+				for(int x = 0; x < w; x++){
+					int x0 = std::min(2*x, prev.width()-1), x1 = std::min(2*x+1, prev.width()-1);
+					RGB c;
+					for(int k = 0; k < 3; k++)
+						channel(c, k) = (channel(prev(x0, y0), k) + channel(prev(x1, y0), k) +
+							channel(prev(x0, y1), k) + channel(prev(x1, y1), k) + 2)/4;
+					next(x, y) = c;
+				}
+			}
+			mipmaps.push_back(std::move(next));
+		}
+		setLayout(layout);
+	}
+
+	// Converte img e seus mipmaps para a organização de texels dada (ver TexelStorage.h).
+	// Deve ser chamada ao carregar a textura, depois de generateMipmaps (que mantém a organização).
+	void setLayout(TexelLayout new_layout){
+		layout = new_layout;
+		storage.clear();
+		if(layout == ROW_MAJOR)
+			return;
+
+		for(int i = 0; i < levels(); i++)
+			storage.emplace_back(level(i), layout);
+	}
+
+	TexelLayout getLayout() const{
+		return layout;
+	}
+
+	int levels() const{
+		return 1 + mipmaps.size();
+	}
+
+	const ImageRGB& level(int i) const{
+		return i == 0? img: mipmaps[i-1];
+	}
+
+	// nível i na organização de getLayout(), ou nullptr se for ROW_MAJOR (usa level(i))
+	const TexelStorage* texels(int i) const{
+		return storage.empty()? nullptr: &storage[i];
+	}
+
+	// memória ocupada pelos texels, em bytes
+	size_t memory() const{
+		size_t bytes = 0;
+		for(int i = 0; i < levels(); i++){
+			size_t n = (size_t)level(i).width()*level(i).height();
+			bytes += n*sizeof(RGB);
+			if(!storage.empty())
+				bytes += storage[i].memory();
+		}
+		return bytes;
+	}
+
+	protected:
+	static unsigned char& channel(RGB& c, int k){
+		return reinterpret_cast<unsigned char*>(&c)[k];
+	}
+
+	static unsigned char channel(const RGB& c, int k){
+		return reinterpret_cast<const unsigned char*>(&c)[k];
+	}
+
+	private:
+	std::vector<ImageRGB> mipmaps; // níveis 1, 2, ...
+	TexelLayout layout = ROW_MAJOR;
+	std::vector<TexelStorage> storage; // todos os níveis, se layout != ROW_MAJOR
+};
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef TEXTURE_LOD_SHADER_H
+#define TEXTURE_LOD_SHADER_H
+
+#include "matrix.h"
+#include "Color.h"
+#include "VertexUtils.h"
+#include "Sampler2D.h"
+
+// Como o TextureShader, mas usa as derivadas das coordenadas de textura na tela
+// (calculadas pelo Render3D por quad 2x2) para filtrar com mipmaps e anisotropia.
+// A textura não é copiada: o Sampler2D pertence a quem desenha.
+struct TextureLODShader{
+	struct Varying{
+		vec4 position;
+		vec2 texCoords;
+	};
+
+	mat4 M;
+	const Sampler2D* texture = nullptr;
+
+	template<class Vertex>
+	void vertexShader(Vertex in, Varying& out){
+		out.position = M*getPosition(in);
+		out.texCoords = in.texCoords;
+	}
+
+	void fragmentShader(Varying V, RGB& fragColor){
+		fragColor = texture->sample(V.texCoords);
+	}
+
+	void fragmentShader(Varying V, Varying dVdx, Varying dVdy, RGB& fragColor){
+		fragColor = texture->sample(V.texCoords, dVdx.texCoords, dVdy.texCoords);
+	}
+};
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef TEXTURE_STORE_H
+#define TEXTURE_STORE_H
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "Texture.h"
+
+// Texturas decodificadas, compartilhadas por todas as malhas: cada arquivo é decodificado uma vez.
+// As texturas são devolvidas por shared_ptr; um Sampler2D só guarda uma referência (Sampler2D::bind).
+// As texturas que ninguém mais usa continuam guardadas até o total passar de budget bytes,
+// e então são descartadas da menos recentemente usada para a mais recente.
+class TextureStore
+{
+	struct Entry
+	{
+		std::shared_ptr<const Texture> texture;
+		size_t bytes;
+		std::list<std::string>::iterator lru;
+	};
+
+	std::mutex mutex;
+	std::unordered_map<std::string, Entry> entries;
+	std::list<std::string> lru; // da mais recente para a menos recente
+	size_t budget;
+	size_t bytes = 0;
+
+public:
+	// como as texturas são preparadas ao serem carregadas
+	bool mipmaps = true;
+	TexelLayout layout = ROW_MAJOR;
+
+	explicit TextureStore(size_t budget = size_t{512} << 20) : budget{budget} {}
+
+	TextureStore(const TextureStore &) = delete;
+	TextureStore &operator=(const TextureStore &) = delete;
+
+	// Textura do arquivo file, decodificada só na primeira vez; nullptr se file for vazio.
+	std::shared_ptr<const Texture> load(const std::string &file)
+	{
+		if (file.empty())
+			return nullptr;
+
+		if (auto texture = find(file))
+			return texture;
+
+		// decodifica fora do lock: outras threads podem carregar outras texturas
+		return add(file, ImageRGB{file});
+	}
+
+	// Guarda img com o nome dado; se o nome já existe, devolve a textura já guardada.
+	std::shared_ptr<const Texture> add(const std::string &name, ImageRGB img)
+	{
+		auto texture = std::make_shared<Texture>(std::move(img));
+		if (mipmaps)
+			texture->generateMipmaps();
+		texture->setLayout(layout);
+
+		std::lock_guard<std::mutex> lock{mutex};
+		auto it = entries.find(name);
+		if (it != entries.end())
+		{
+			touch(it->second);
+			return it->second.texture;
+		}
+
+		lru.push_front(name);
+		Entry entry{texture, texture->memory(), lru.begin()};
+		bytes += entry.bytes;
+		entries.emplace(name, std::move(entry));
+		trim();
+		return texture;
+	}
+
+	std::shared_ptr<const Texture> find(const std::string &name)
+	{
+		std::lock_guard<std::mutex> lock{mutex};
+		auto it = entries.find(name);
+		if (it == entries.end())
+			return nullptr;
+
+		touch(it->second);
+		return it->second.texture;
+	}
+
+	void setBudget(size_t new_budget)
+	{
+		std::lock_guard<std::mutex> lock{mutex};
+		budget = new_budget;
+		trim();
+	}
+
+	// memória, em bytes, das texturas guardadas (inclusive as que estão em uso)
+	size_t memory()
+	{
+		std::lock_guard<std::mutex> lock{mutex};
+		return bytes;
+	}
+
+	size_t size()
+	{
+		std::lock_guard<std::mutex> lock{mutex};
+		return entries.size();
+	}
+
+private:
+	void touch(Entry &entry)
+	{
+		lru.splice(lru.begin(), lru, entry.lru);
+	}
+
+	// descarta as texturas sem uso, da menos recente para a mais recente, até caber no orçamento.
+	// Texturas em uso não liberariam memória e ficam.
+	void trim()
+	{
+		for (auto it = lru.end(); bytes > budget && it != lru.begin();)
+		{
+			--it;
+			Entry &entry = entries.at(*it);
+			if (entry.texture.use_count() > 1)
+				continue;
+
+			bytes -= entry.bytes;
+			entries.erase(*it);
+			it = lru.erase(it);
+		}
+	}
+};
+
+inline TextureStore &defaultTextureStore()
+{
+	static TextureStore store;
+	return store;
+}
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Conjunto fixo de threads que executam laços parallel_for.
+// A thread que chama parallel_for também trabalha e só retorna quando
+// todas as iterações terminaram. Não chame parallel_for de dentro de um job.
+class ThreadPool
+{
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake, done;
+
+	std::function<void(unsigned int)> job;
+	std::atomic<unsigned int> next{0};
+	unsigned int njobs = 0;
+	unsigned int generation = 0;
+	unsigned int active = 0;
+	bool stop = false;
+
+public:
+	explicit ThreadPool(unsigned int nthreads = std::thread::hardware_concurrency())
+	{
+		for (unsigned int i = 1; i < nthreads; i++)
+			workers.emplace_back([this] { loop(); });
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock{mutex};
+			stop = true;
+		}
+		wake.notify_all();
+		for (std::thread &t : workers)
+			t.join();
+	}
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	unsigned int size() const { return workers.size() + 1; }
+
+	// chama f(i) para i = 0, ..., n-1, distribuindo os índices entre as threads
+	template <class F>
+	void parallel_for(unsigned int n, F f)
+	{
+		if (n == 0)
+			return;
+
+		if (workers.empty() || n == 1)
+		{
+			for (unsigned int i = 0; i < n; i++)
+				f(i);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock{mutex};
+			job = f;
+			njobs = n;
+			next = 0;
+			active = workers.size();
+			generation++;
+		}
+		wake.notify_all();
+
+		run();
+
+		std::unique_lock<std::mutex> lock{mutex};
+		done.wait(lock, [this] { return active == 0; });
+		job = nullptr;
+	}
+
+private:
+	void run()
+	{
+		for (unsigned int i = next++; i < njobs; i = next++)
+			job(i);
+	}
+
+	void loop()
+	{
+		unsigned int seen = 0;
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock{mutex};
+				wake.wait(lock, [&] { return stop || generation != seen; });
+				if (stop)
+					return;
+				seen = generation;
+			}
+
+			run();
+
+			std::lock_guard<std::mutex> lock{mutex};
+			if (--active == 0)
+				done.notify_one();
+		}
+	}
+};
+
+// pool compartilhado pelo processo, com uma thread por núcleo
+inline ThreadPool &defaultThreadPool()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+#endif
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <vector>
+#include "Render3D.h"
+#include "ThreadPool.h"
+
+// Versão em paralelo do Render3D.
+// As primitivas são processadas em lotes. Depois do recorte, as primitivas de um lote
+// são distribuídas em ladrilhos (tiles) da tela pelo seu retângulo envolvente. Cada ladrilho é desenhado por uma única thread,
+// que só escreve nos seus pixels da imagem (e do ZBuffer), portanto não há travas.
+// Como cada ladrilho desenha suas primitivas na ordem original, o resultado é
+// idêntico, pixel a pixel, ao do Render3D serial.
+template <class VertexAttrib, class Prims, class Shader, class ImageType>
+struct TiledRender3D
+{
+	using Render = Render3D<VertexAttrib, Prims, Shader, ImageType>;
+
+	static constexpr int tile_size = 64;
+
+	// primitivas por lote: cada lote é distribuído e desenhado antes do próximo
+	static constexpr unsigned int batch_size = 16384;
+
+	TiledRender3D(const VertexAttrib &V, const Prims &p, Shader &shader, ImageType &image,
+				  ThreadPool &pool = defaultThreadPool())
+		: TiledRender3D{V, p, shader, image, FRUSTUM_INTERSECTS, pool}
+	{
+	}
+
+	// visibility e culling: como no Render3D
+	TiledRender3D(const VertexAttrib &V, const Prims &p, Shader &shader, ImageType &image,
+				  FrustumTest visibility, ThreadPool &pool = defaultThreadPool())
+		: TiledRender3D{V, p, shader, image, visibility, Culling{}, pool}
+	{
+	}
+
+	TiledRender3D(const VertexAttrib &V, const Prims &p, Shader &shader, ImageType &image,
+				  FrustumTest visibility, Culling culling, ThreadPool &pool = defaultThreadPool())
+	{
+		if (visibility == FRUSTUM_OUTSIDE)
+			return;
+
+		Render render{shader, image, {0, 0, image.width(), image.height()}, culling};
+		ProfileEvent event{render.profile, "TiledRender3D"};
+		if (render.profile)
+			pipelineProfiler().target(image.width(), image.height());
+
+		int tiles_x = (image.width() + tile_size - 1) / tile_size;
+		int tiles_y = (image.height() + tile_size - 1) / tile_size;
+
+		std::vector<std::vector<unsigned int>> bins(tiles_x * tiles_y);
+		std::vector<typename Render::Primitive> primitives;
+
+		render.forEachBatch(V, p, batch_size, [&](const auto &batch)
+		{
+			ProfileStage stage{render.profile, STAGE_CLIP};
+			primitives.clear();
+			for (const auto &primitive : batch)
+				if (render.culledBeforeClip(primitive))
+					continue;
+				else if (visibility == FRUSTUM_INSIDE)
+					primitives.push_back(primitive);
+				else
+					clip(primitive, [&](const auto &clipped) { primitives.push_back(clipped); });
+
+			ProfileStage bin_stage{render.profile, STAGE_BIN};
+			for (auto &bin : bins)
+				bin.clear();
+			for (unsigned int i = 0; i < primitives.size(); i++)
+			{
+				if (render.culledOnScreen(primitives[i]))
+					continue;
+
+				PixelRect R = screenBounds(render, primitives[i]);
+				if (R.x0 >= R.x1 || R.y0 >= R.y1)
+					continue;
+
+				for (int ty = R.y0 / tile_size; ty <= (R.y1 - 1) / tile_size; ty++)
+					for (int tx = R.x0 / tile_size; tx <= (R.x1 - 1) / tile_size; tx++)
+						bins[ty * tiles_x + tx].push_back(i);
+			}
+			bin_stage.stop();
+			stage.stop();
+
+			pool.parallel_for(bins.size(), [&](unsigned int t)
+			{
+				if (bins[t].empty())
+					return;
+
+				int x0 = (t % tiles_x) * tile_size;
+				int y0 = (t / tiles_x) * tile_size;
+				PixelRect tile = {
+					x0, y0,
+					std::min(x0 + tile_size, image.width()),
+					std::min(y0 + tile_size, image.height())};
+
+				Render tile_render{shader, image, tile, culling};
+				ProfileEvent event{tile_render.profile, "tile"};
+				for (unsigned int i : bins[t])
+					tile_render.draw(primitives[i]);
+			});
+		});
+	}
+
+	// retângulo (conservador) de pixels da imagem coberto pela primitiva
+	template <class Primitive>
+	static PixelRect screenBounds(const Render &render, const Primitive &P)
+	{
+		int w = render.image.width();
+		int h = render.image.height();
+
+		float xmin = INFINITY, ymin = INFINITY;
+		float xmax = -INFINITY, ymax = -INFINITY;
+		for (const auto &v : P)
+		{
+			vec2 s = render.toScreen(v.position);
+			xmin = std::min(xmin, s[0]);
+			ymin = std::min(ymin, s[1]);
+			xmax = std::max(xmax, s[0]);
+			ymax = std::max(ymax, s[1]);
+		}
+		return {
+			(int)clamp(floor(xmin) - 1, 0, w), (int)clamp(floor(ymin) - 1, 0, h),
+			(int)clamp(ceil(xmax) + 2, 0, w), (int)clamp(ceil(ymax) + 2, 0, h)};
+	}
+};
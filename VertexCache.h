@@ -0,0 +1,211 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <deque>
+#include <vector>
+
+// Índices distintos de um lote de primitivas, na ordem em que aparecem. Usado pelo Render3D
+// para passar cada vértice do lote pelo vertexShader uma única vez.
+// Tabela de espalhamento com sondagem linear, refeita a cada lote: a memória é proporcional
+// ao lote, não à malha.
+class UniqueIndices
+{
+	std::vector<unsigned int> keys;	 // UINT_MAX: posição vazia
+	std::vector<unsigned int> slots; // posição de keys[h] em indices
+	unsigned int mask = 0;
+
+public:
+	std::vector<unsigned int> indices;
+
+	// esvazia o conjunto, com espaço para até n índices
+	void clear(size_t n)
+	{
+		size_t size = 16;
+		while (size < 2 * n)
+			size *= 2;
+		keys.assign(size, UINT_MAX);
+		slots.resize(size);
+		mask = size - 1;
+		indices.clear();
+	}
+
+	// posição de i em indices; i é incluído se ainda não estiver
+	unsigned int insert(unsigned int i)
+	{
+		unsigned int h = (i * 2654435761u) & mask;
+		while (keys[h] != i)
+		{
+			if (keys[h] == UINT_MAX)
+			{
+				keys[h] = i;
+				slots[h] = indices.size();
+				indices.push_back(i);
+				break;
+			}
+			h = (h + 1) & mask;
+		}
+		return slots[h];
+	}
+};
+
+// ACMR (average cache miss ratio): vértices transformados por triângulo,
+// simulando uma cache FIFO de cache_size vértices.
+// Fica entre 0.5 (malhas regulares, ordem ideal) e 3 (nenhum reaproveitamento).
+inline double acmr(const std::vector<unsigned int> &indices, unsigned int cache_size = 32)
+{
+	if (indices.size() < 3)
+		return 0;
+
+	std::deque<unsigned int> fifo;
+	size_t misses = 0;
+	for (unsigned int i : indices)
+	{
+		if (std::find(fifo.begin(), fifo.end(), i) != fifo.end())
+			continue;
+
+		misses++;
+		fifo.push_back(i);
+		if (fifo.size() > cache_size)
+			fifo.pop_front();
+	}
+	return misses / (double)(indices.size() / 3);
+}
+
+// Reordena os triângulos (3 índices por triângulo) para aproveitar a cache de vértices,
+// pelo algoritmo de Tom Forsyth ("Linear-Speed Vertex Cache Optimisation").
+// A cada passo escolhe o triângulo de maior pontuação entre os que usam vértices
+// da cache LRU simulada; vértices com poucos triângulos restantes ganham bônus.
+// Sem candidatos na cache, recomeça por um vértice que saiu dela há pouco com triângulos
+// restantes (pilha de becos sem saída, como no Tipsify) ou, sem nenhum, pelo próximo
+// triângulo na ordem original: cada passo é proporcional ao tamanho da cache, não da malha.
+inline std::vector<unsigned int> optimizeVertexCache(const std::vector<unsigned int> &indices, unsigned int vertex_count,
+													 unsigned int cache_size = 32)
+{
+	const float cache_decay_power = 1.5;
+	const float last_triangle_score = 0.75;
+	const float valence_boost_scale = 2;
+	const float valence_boost_power = 0.5;
+
+	unsigned int n = indices.size() / 3;
+
+	// triângulos de cada vértice
+	std::vector<unsigned int> first(vertex_count + 1, 0);
+	for (unsigned int i = 0; i < 3 * n; i++)
+		first[indices[i] + 1]++;
+	for (unsigned int v = 0; v < vertex_count; v++)
+		first[v + 1] += first[v];
+
+	std::vector<unsigned int> adjacency(3 * n);
+	std::vector<unsigned int> remaining(vertex_count, 0); // triângulos ainda não emitidos
+	for (unsigned int i = 0; i < 3 * n; i++)
+	{
+		unsigned int v = indices[i];
+		adjacency[first[v] + remaining[v]++] = i / 3;
+	}
+
+	std::vector<int> cache_position(vertex_count, -1);
+	auto vertexScore = [&](unsigned int v)
+	{
+		if (remaining[v] == 0)
+			return -1.0f;
+
+		float score = 0;
+		int p = cache_position[v];
+		if (p >= 0)
+			score = p < 3 ? last_triangle_score
+						  : powf(1 - (p - 3) / (float)(cache_size - 3), cache_decay_power);
+		return score + valence_boost_scale * powf((float)remaining[v], -valence_boost_power);
+	};
+
+	std::vector<float> vertex_score(vertex_count);
+	for (unsigned int v = 0; v < vertex_count; v++)
+		vertex_score[v] = vertexScore(v);
+
+	std::vector<float> triangle_score(n);
+	std::vector<bool> emitted(n, false);
+	for (unsigned int t = 0; t < n; t++)
+		triangle_score[t] = vertex_score[indices[3 * t]] + vertex_score[indices[3 * t + 1]] + vertex_score[indices[3 * t + 2]];
+
+	std::vector<unsigned int> result;
+	result.reserve(3 * n);
+
+	std::vector<unsigned int> cache, next_cache;
+	std::vector<unsigned int> dead_end; // vértices que saíram da cache com triângulos restantes
+	unsigned int scan = 0;				// triângulos antes de scan já foram emitidos
+	int best = -1;
+	for (unsigned int k = 0; k < n; k++)
+	{
+		// nenhum candidato na cache: o melhor triângulo do último vértice da pilha que ainda tem algum
+		while (best < 0 && !dead_end.empty())
+		{
+			unsigned int v = dead_end.back();
+			dead_end.pop_back();
+			for (unsigned int i = first[v]; i < first[v] + remaining[v]; i++)
+				if (best < 0 || triangle_score[adjacency[i]] > triangle_score[best])
+					best = adjacency[i];
+		}
+
+		// pilha vazia: o próximo triângulo na ordem original
+		if (best < 0)
+		{
+			while (emitted[scan])
+				scan++;
+			best = scan;
+		}
+
+		const unsigned int *tri = &indices[3 * best];
+		result.insert(result.end(), tri, tri + 3);
+		emitted[best] = true;
+
+		// retira o triângulo das listas dos seus vértices
+		for (int j = 0; j < 3; j++)
+		{
+			unsigned int v = tri[j];
+			unsigned int *adj = &adjacency[first[v]];
+			unsigned int *end = adj + remaining[v];
+			*std::find(adj, end, (unsigned int)best) = end[-1];
+			remaining[v]--;
+		}
+
+		// os vértices do triângulo vão para o início da cache LRU
+		next_cache.assign(tri, tri + 3);
+		for (unsigned int v : cache)
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				next_cache.push_back(v);
+		std::swap(cache, next_cache);
+
+		for (unsigned int i = 0; i < cache.size(); i++)
+		{
+			unsigned int v = cache[i];
+			cache_position[v] = i < cache_size ? i : -1;
+			vertex_score[v] = vertexScore(v);
+		}
+
+		// atualiza os triângulos que usam vértices da cache e escolhe o próximo
+		best = -1;
+		float best_score = -1;
+		for (unsigned int v : cache)
+			for (unsigned int i = first[v]; i < first[v] + remaining[v]; i++)
+			{
+				unsigned int t = adjacency[i];
+				float score = vertex_score[indices[3 * t]] + vertex_score[indices[3 * t + 1]] + vertex_score[indices[3 * t + 2]];
+				triangle_score[t] = score;
+				if (score > best_score)
+				{
+					best_score = score;
+					best = t;
+				}
+			}
+
+		if (cache.size() > cache_size)
+		{
+			for (unsigned int i = cache_size; i < cache.size(); i++)
+				if (remaining[cache[i]] > 0)
+					dead_end.push_back(cache[i]);
+			cache.resize(cache_size);
+		}
+	}
+	return result;
+}
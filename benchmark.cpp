@@ -0,0 +1,1724 @@
+#include <cstdio>
+#include <random>
+#include <tuple>
+#include <thread>
+#include "Benchmark.h"
+#include "Render2D.h"
+#include "Render3D.h"
+#include "TiledRender3D.h"
+#include "ZBuffer.h"
+#include "HiZBuffer.h"
+#include "Multisample.h"
+#include "FrameBuffer.h"
+#include "ObjMesh.h"
+#include "MeshCache.h"
+#include "ClusterBVH.h"
+#include "ObjParser.h"
+#include "VertexCache.h"
+#include "SimpleShader.h"
+#include "TextureLODShader.h"
+#include "BatchTextureShader.h"
+#include "TextureStore.h"
+#include "FrameSequence.h"
+#include "SoA.h"
+#include "IndexedMarchingCubes.h"
+#include "ImplicitField.h"
+#include "transforms.h"
+
+struct BenchShader
+{
+	struct Varying
+	{
+		vec4 position;
+		vec3 color;
+	};
+
+	mat4 M;
+
+	void vertexShader(vec3 in, Varying &out)
+	{
+		out.position = M * getPosition(in);
+		out.color = {0.5f * in[0] + 0.5f, 0.5f * in[1] + 0.5f, 0.5f * in[2] + 0.5f};
+	}
+
+	void fragmentShader(Varying V, RGB &FragColor)
+	{
+		FragColor = toColor(V.color);
+	}
+};
+
+// conta as chamadas do vertexShader
+struct CountingShader : BenchShader
+{
+	size_t vertices = 0;
+
+	void vertexShader(vec3 in, Varying &out)
+	{
+		vertices++;
+		BenchShader::vertexShader(in, out);
+	}
+};
+
+// n triângulos aleatórios (semente fixa) dentro do cubo [-1,1]³
+std::vector<vec3> random_triangles(int n, float size)
+{
+	std::mt19937 rng{1234};
+	std::uniform_real_distribution<float> U{-1, 1};
+
+	std::vector<vec3> P;
+	for (int i = 0; i < n; i++)
+	{
+		vec3 c = {U(rng), U(rng), U(rng)};
+		for (int j = 0; j < 3; j++)
+			P.push_back(c + size * vec3{U(rng), U(rng), U(rng)});
+	}
+	return P;
+}
+
+void bench_tiled(int w, int h)
+{
+	std::vector<vec3> P = random_triangles(20000, 0.15);
+	Triangles T{P.size()};
+
+	BenchShader shader;
+	mat4 View = lookAt({0, 0, 3}, {0, 0, 0}, {0, 1, 0});
+	mat4 Projection = perspective(45, w / (float)h, 0.1, 100);
+	shader.M = Projection * View;
+
+	ImageRGB serial{w, h};
+	double t_serial = time_ms([&]
+	{
+		serial.fill(white);
+		ImageZBuffer I{serial};
+		Render3D(P, T, shader, I);
+	});
+	printf("tiled %dx%d serial: %.2f ms\n", w, h, t_serial);
+
+	unsigned int max_threads = std::max(1u, std::thread::hardware_concurrency());
+	for (unsigned int n = 1; n <= max_threads; n *= 2)
+	{
+		ThreadPool pool{n};
+		ImageRGB G{w, h};
+		double t = time_ms([&]
+		{
+			G.fill(white);
+			ImageZBuffer I{G};
+			TiledRender3D(P, T, shader, I, pool);
+		});
+		printf("tiled %dx%d threads=%u: %.2f ms (x%.2f) %s\n",
+			   w, h, n, t, t_serial / t, same_pixels(serial, G) ? "ok" : "DIFFERENT");
+	}
+}
+
+void bench_triangle_rasterizers(int w, int h)
+{
+	std::mt19937 rng{4321};
+	std::uniform_real_distribution<float> X{0, (float)w}, Y{0, (float)h}, D{-40, 40};
+
+	std::vector<std::array<vec2, 3>> tris(100000);
+	for (auto &T : tris)
+	{
+		vec2 c = {X(rng), Y(rng)};
+		T = {c + vec2{D(rng), D(rng)}, c + vec2{D(rng), D(rng)}, c + vec2{D(rng), D(rng)}};
+	}
+
+	PixelRect R = {0, 0, w, h};
+	size_t pixels = 0;
+	double t_scan = time_ms([&]
+	{
+		pixels = 0;
+		for (const auto &T : tris)
+			for (Pixel p : scanline(T, R))
+				pixels += barycentric_coords(toVec2(p), T)[0] >= -1;
+	});
+	printf("scanline + barycentric_coords: %.2f ms, %zu pixels\n", t_scan, pixels);
+
+	double t_edge = time_ms([&]
+	{
+		pixels = 0;
+		for (const auto &T : tris)
+			rasterizeTriangle(T, R, [&](Pixel, vec3 t) { pixels += t[0] >= -1; });
+	});
+	printf("edge functions: %.2f ms, %zu pixels (x%.2f)\n", t_edge, pixels, t_scan / t_edge);
+}
+
+void bench_lines(int w, int h)
+{
+	std::mt19937 rng{99};
+	std::uniform_real_distribution<float> X{0, (float)w}, Y{0, (float)h};
+
+	std::vector<std::array<vec2, 2>> lines(200000);
+	for (auto &L : lines)
+		L = {vec2{X(rng), Y(rng)}, vec2{X(rng), Y(rng)}};
+
+	size_t pixels = 0;
+	double t_vector = time_ms([&]
+	{
+		pixels = 0;
+		for (const auto &L : lines)
+			for (Pixel p : rasterizeLine(L))
+				pixels += p.x >= 0;
+	});
+	printf("lines std::vector<Pixel>: %.2f ms, %zu pixels\n", t_vector, pixels);
+
+	double t_visitor = time_ms([&]
+	{
+		pixels = 0;
+		for (const auto &L : lines)
+			rasterizeLine(L, [&](Pixel p) { pixels += p.x >= 0; });
+	});
+	printf("lines visitor: %.2f ms, %zu pixels (x%.2f)\n", t_visitor, pixels, t_vector / t_visitor);
+}
+
+// recorte de triângulos já transformados: caminho antigo (polígonos em std::vector)
+// contra o recorte com outcodes e polígono na pilha
+void bench_clip(const char *name, const std::vector<vec3> &P, mat4 M)
+{
+	using Varying = BenchShader::Varying;
+
+	BenchShader shader;
+	shader.M = M;
+	std::vector<Varying> V(P.size());
+	for (unsigned int i = 0; i < P.size(); i++)
+		shader.vertexShader(P[i], V[i]);
+	auto tris = assemble(Triangles{V.size()}, V);
+
+	size_t n_old = 0;
+	double t_old = time_ms([&]
+	{
+		n_old = 0;
+		for (const auto &T : tris)
+		{
+			std::vector<Varying> poly = clip(std::vector<Varying>{T[0], T[1], T[2]});
+			for (const auto &C : assemble(TriangleFan{poly.size()}, poly))
+				n_old += C[0].position[3] > 0;
+		}
+	});
+	printf("clip %s std::vector: %.2f ms, %zu -> %zu triangles\n", name, t_old, tris.size(), n_old);
+
+	size_t n_new = 0;
+	double t_new = time_ms([&]
+	{
+		n_new = 0;
+		for (const auto &T : tris)
+			clip(T, [&](const auto &C) { n_new += C[0].position[3] > 0; });
+	});
+	printf("clip %s outcodes: %.2f ms, %zu -> %zu triangles (x%.2f)\n", name, t_new, tris.size(), n_new, t_old / t_new);
+}
+
+void bench_clip(int w, int h, int argc, char *argv[])
+{
+	mat4 Projection = perspective(45, w / (float)h, 0.1, 100);
+
+	// câmera dentro da nuvem de triângulos: boa parte cruza os planos de recorte
+	std::vector<vec3> P = random_triangles(200000, 0.3);
+	bench_clip("synthetic", P, Projection * lookAt({0, 0, 0.5}, {0, 0, -1}, {0, 1, 0}));
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::vector<vec3> Q;
+		for (const ObjMesh::Vertex &v : ObjMesh{argv[i]}.getTriangles())
+			Q.push_back(v.position);
+		if (Q.empty())
+			continue;
+
+		// enquadra o modelo e aproxima a câmera até que ele saia da tela
+		vec3 pmin = Q[0], pmax = Q[0];
+		for (vec3 q : Q)
+			for (int j = 0; j < 3; j++)
+			{
+				pmin[j] = std::min(pmin[j], q[j]);
+				pmax[j] = std::max(pmax[j], q[j]);
+			}
+		vec3 c = 0.5 * (pmin + pmax);
+		float r = norm(pmax - pmin);
+		bench_clip(argv[i], Q, Projection * lookAt(c + vec3{0, 0, 0.6f * r}, c, {0, 1, 0}));
+	}
+}
+
+// OBJ de uma grade n x n com coordenadas de textura e normais, em 4 materiais
+std::string synthetic_obj(int n)
+{
+	std::filesystem::path dir = std::filesystem::temp_directory_path();
+	FILE *f = fopen((dir / "synthetic.mtl").string().c_str(), "w");
+	for (int i = 1; i < 4; i++)
+		fprintf(f, "newmtl material%d\nKd 0.5 0.25 0.125\nmap_Kd material%d.png\n", i, i);
+	fclose(f);
+
+	std::string file = (dir / ("synthetic" + std::to_string(n) + ".obj")).string();
+	f = fopen(file.c_str(), "w");
+	fprintf(f, "mtllib synthetic.mtl\n");
+	for (int y = 0; y <= n; y++)
+		for (int x = 0; x <= n; x++)
+			fprintf(f, "v %f %f %f\nvt %f %f\nvn 0 0 1\n", x / (float)n, y / (float)n, 0.1f * sinf(x * 0.1f),
+					x / (float)n, y / (float)n);
+	for (int y = 0; y < n; y++)
+	{
+		if (y % (n / 4) == 0 && y > 0)
+			fprintf(f, "usemtl material%d\n", y / (n / 4));
+		for (int x = 0; x < n; x++)
+		{
+			int a = y * (n + 1) + x + 1, b = a + 1, c = a + n + 2, d = a + n + 1;
+			fprintf(f, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, c, c, c, d, d, d);
+		}
+	}
+	fclose(f);
+	return file;
+}
+
+// Carga pelo ObjMesh contra o CachedObjMesh: sem cache (gera o arquivo),
+// com cache (só mmap), e com o OBJ com data nova e o mesmo conteúdo (confere o hash)
+void bench_mesh_cache(int argc, char *argv[])
+{
+	std::vector<std::string> files = {synthetic_obj(500)};
+	files.insert(files.end(), argv + 1, argv + argc);
+
+	for (const std::string &obj : files)
+	{
+		std::string cache = obj + ".cache";
+		std::error_code error;
+		std::filesystem::remove(cache, error);
+
+		std::vector<ObjMesh::Vertex> parsed;
+		std::vector<MaterialRange> parsed_materials;
+		double t_parse = time_ms([&]
+		{
+			ObjMesh mesh{obj};
+			parsed = mesh.getTriangles();
+			parsed_materials = mesh.getMaterials({});
+		}, 1);
+
+		double t_cold = time_ms([&] { CachedObjMesh{obj}; }, 1);
+
+		double t_warm = time_ms([&]
+		{
+			CachedObjMesh mesh{obj};
+			mesh.getTriangles();
+			mesh.getMaterials({});
+		});
+
+		// o cache reordena os triângulos de cada material em clusters: compara os triângulos ordenados
+		CachedObjMesh mesh{obj};
+		ArrayView<ObjMesh::Vertex> view = mesh.getTriangles();
+		std::vector<ObjMesh::Vertex> tris{view.begin(), view.end()};
+		std::vector<MaterialRange> materials = mesh.getMaterials({});
+		size_t n = tris.size();
+		bool same = n == parsed.size() && materials.size() == parsed_materials.size();
+		for (size_t i = 0; same && i < materials.size(); i++)
+		{
+			same = materials[i].first == parsed_materials[i].first && materials[i].count == parsed_materials[i].count &&
+				   materials[i].mat.map_Kd == parsed_materials[i].mat.map_Kd;
+			for (auto *T : {&tris, &parsed})
+			{
+				using Tri = std::array<char, 3 * sizeof(ObjMesh::Vertex)>;
+				Tri *first = reinterpret_cast<Tri *>(T->data() + materials[i].first);
+				std::sort(first, first + materials[i].count / 3);
+			}
+		}
+		same = same && memcmp(tris.data(), parsed.data(), n * sizeof(ObjMesh::Vertex)) == 0;
+
+		std::filesystem::last_write_time(obj, std::filesystem::file_time_type::clock::now(), error);
+		bool rehashed = false;
+		double t_touched = time_ms([&] { rehashed = CachedObjMesh{obj}.rehashed; }, 1);
+
+		printf("%s: %zu vertices, ObjMesh %.1f ms, cache cold %.1f ms, warm %.3f ms (x%.0f), touched %.1f ms%s%s\n",
+			   obj.c_str(), n, t_parse, t_cold, t_warm, t_parse / t_warm, t_touched, rehashed ? " (rehashed)" : "",
+			   same ? "" : " DIFFERENT");
+	}
+}
+
+// Câmera no centro de um anel de 16 objetos, com 4 faixas de material cada, girando:
+// tudo pelo Render3D contra o teste das caixas de cada objeto e de cada faixa com frustumTest
+void bench_frustum_culling(int w, int h)
+{
+	const int objects = 16, ranges = 4, tris_per_range = 5000;
+	std::vector<vec3> P;
+	for (int k = 0; k < objects; k++)
+	{
+		float a = 2 * M_PI * k / objects;
+		vec3 c = {6 * cosf(a), 0, 6 * sinf(a)};
+		for (int r = 0; r < ranges; r++)
+		{
+			vec3 cr = c + vec3{0, 0.5f * r - 0.75f, 0};
+			for (vec3 p : random_triangles(tris_per_range, 0.1))
+				P.push_back(cr + 0.25f * p);
+		}
+	}
+
+	unsigned int range_size = 3 * tris_per_range;
+	std::vector<AABB> object_boxes, range_boxes;
+	for (int k = 0; k < objects; k++)
+	{
+		AABB object;
+		for (int r = 0; r < ranges; r++)
+		{
+			range_boxes.push_back(boundingBox(P, (k * ranges + r) * range_size, range_size));
+			object.add(range_boxes.back());
+		}
+		object_boxes.push_back(object);
+	}
+
+	mat4 Projection = perspective(45, w / (float)h, 0.1, 100);
+	const int frames = 8;
+	auto render = [&](ImageRGB &G, CountingShader &shader, int frame, bool cull)
+	{
+		shader.M = Projection * lookAt({0, 0, 0}, {cosf(0.7f * frame), 0, sinf(0.7f * frame)}, {0, 1, 0});
+		G.fill(white);
+		ImageZBuffer I{G};
+		for (int k = 0; k < objects; k++)
+		{
+			if (cull && frustumTest(shader.M, object_boxes[k]) == FRUSTUM_OUTSIDE)
+				continue;
+
+			for (int r = 0; r < ranges; r++)
+			{
+				int i = k * ranges + r;
+				FrustumTest visibility = cull ? frustumTest(shader.M, range_boxes[i]) : FRUSTUM_INTERSECTS;
+				Render3D(P, TrianglesRange{i * range_size, range_size}, shader, I, visibility);
+			}
+		}
+	};
+
+	ImageRGB A{w, h}, B{w, h};
+	CountingShader all, culled;
+	bool same = true;
+	double t_all = 0, t_culled = 0;
+	for (int f = 0; f < frames; f++)
+	{
+		t_all += time_ms([&] { render(A, all, f, false); }, 1);
+		t_culled += time_ms([&] { render(B, culled, f, true); }, 1);
+		same = same && same_pixels(A, B);
+	}
+	printf("frustum %d frames: all %.2f ms/frame, %zu vertices; culled %.2f ms/frame, %zu vertices (x%.2f) %s\n",
+		   frames, t_all / frames, all.vertices / frames, t_culled / frames, culled.vertices / frames,
+		   t_all / t_culled, same ? "ok" : "DIFFERENT");
+}
+
+// face retangular o + [0,1]u + [0,1]v dividida em k x k quadrados, virada para u x v
+void add_quad_grid(std::vector<vec3> &P, vec3 o, vec3 u, vec3 v, int k)
+{
+	for (int j = 0; j < k; j++)
+		for (int i = 0; i < k; i++)
+		{
+			vec3 a = o + (i / (float)k) * u + (j / (float)k) * v;
+			vec3 du = (1.0f / k) * u, dv = (1.0f / k) * v;
+			for (vec3 p : {a, a + du, a + du + dv, a, a + du + dv, a + dv})
+				P.push_back(p);
+		}
+}
+
+// chão e G x G prédios fechados (sem a base), com as faces divididas em k x k quadrados
+std::vector<vec3> city_mesh(int G, int k)
+{
+	std::mt19937 rng{7};
+	std::uniform_real_distribution<float> H{2, 8};
+
+	std::vector<vec3> P;
+	float L = 2 * G + 1;
+	add_quad_grid(P, {-L, 0, L}, {2 * L, 0, 0}, {0, 0, -2 * L}, 64);
+	for (int j = -G / 2; j < G / 2; j++)
+		for (int i = -G / 2; i < G / 2; i++)
+		{
+			float x0 = 4 * i, x1 = x0 + 2, z0 = 4 * j, z1 = z0 + 2, y = H(rng);
+			add_quad_grid(P, {x1, 0, z1}, {0, 0, z0 - z1}, {0, y, 0}, k);
+			add_quad_grid(P, {x0, 0, z0}, {0, 0, z1 - z0}, {0, y, 0}, k);
+			add_quad_grid(P, {x0, 0, z1}, {x1 - x0, 0, 0}, {0, y, 0}, k);
+			add_quad_grid(P, {x1, 0, z0}, {x0 - x1, 0, 0}, {0, y, 0}, k);
+			add_quad_grid(P, {x0, y, z1}, {x1 - x0, 0, 0}, {0, 0, z0 - z1}, k);
+		}
+	return P;
+}
+
+// Câmera na rua de uma cidade de prédios fechados, olhando em 8 direções:
+// a malha inteira pelo Render3D contra os clusters da BVH, só com o volume de visão e também com o cone de normais
+void bench_cluster_culling(int w, int h)
+{
+	std::vector<vec3> P = city_mesh(12, 8);
+
+	std::vector<BVHNode> nodes;
+	std::vector<Cluster> clusters;
+	double t_build = time_ms([&]
+	{
+		nodes.clear();
+		clusters.clear();
+		buildClusterBVH(P.data(), 0, P.size(), nodes, clusters);
+	}, 1);
+	printf("cluster BVH: %zu triangles, %zu clusters, %zu nodes, built in %.1f ms\n",
+		   P.size() / 3, clusters.size(), nodes.size(), t_build);
+
+	mat4 Projection = perspective(45, w / (float)h, 0.1, 100);
+	const int frames = 8;
+	auto view = [&](int frame)
+	{
+		float a = 2 * M_PI * frame / frames;
+		return Projection * lookAt({3, 1.6, 3}, {3 + cosf(a), 1.5, 3 + sinf(a)}, {0, 1, 0});
+	};
+
+	ImageRGB A{w, h}, B{w, h}, C{w, h};
+	CountingShader all, frustum, cone;
+	ClusterCullStats frustum_stats, cone_stats;
+	std::vector<ClusterRange> ranges;
+	size_t different = 0;
+	bool same = true;
+	double t_all = 0, t_frustum = 0, t_cone = 0;
+	for (int f = 0; f < frames; f++)
+	{
+		t_all += time_ms([&]
+		{
+			all.M = view(f);
+			A.fill(white);
+			ImageZBuffer I{A};
+			Render3D(P, Triangles{P.size()}, all, I);
+		}, 1);
+
+		for (bool backfaces : {false, true})
+		{
+			CountingShader &shader = backfaces ? cone : frustum;
+			ImageRGB &G = backfaces ? C : B;
+			(backfaces ? t_cone : t_frustum) += time_ms([&]
+			{
+				shader.M = view(f);
+				G.fill(white);
+				ImageZBuffer I{G};
+				ranges.clear();
+				cullClusters(nodes, clusters, 0, shader.M, backfaces, ranges, backfaces ? &cone_stats : &frustum_stats);
+				for (const ClusterRange &r : ranges)
+					Render3D(P, TrianglesRange{r.first, r.count}, shader, I, r.visibility);
+			}, 1);
+		}
+
+		same = same && same_pixels(A, B);
+		for (int y = 0; y < h; y++)
+			for (int x = 0; x < w; x++)
+				different += memcmp(&A(x, y), &C(x, y), sizeof(RGB)) != 0;
+	}
+
+	size_t n = P.size() / 3;
+	printf("clusters all: %.2f ms/frame, %zu vertices, %zu triangles\n", t_all / frames, all.vertices / frames, n);
+	printf("clusters frustum: %.2f ms/frame, %zu vertices, %zu triangles, %zu nodes tested (x%.2f) %s\n",
+		   t_frustum / frames, frustum.vertices / frames, frustum_stats.triangles_drawn / frames,
+		   frustum_stats.nodes_tested / frames, t_all / t_frustum, same ? "ok" : "DIFFERENT");
+	printf("clusters frustum+cone: %.2f ms/frame, %zu vertices, %zu triangles, %zu clusters backfacing (x%.2f), "
+		   "%zu pixels differ\n",
+		   t_cone / frames, cone.vertices / frames, cone_stats.triangles_drawn / frames,
+		   cone_stats.backface_culled / frames, t_all / t_cone, different);
+}
+
+// Descarte dos triângulos de costas, sem descarte, depois do recorte (área na tela) e antes
+// (coordenadas de recorte): o corpo de metaballs do bonecoMorcego, de fora, e a cidade, de dentro.
+// As malhas são fechadas, então as imagens devem ser iguais.
+void bench_backface_culling(int w, int h)
+{
+	MetaballField figure{0.7, {
+		{1, 1.8, {0, 0, 0}},
+		{1, 0.7, {0, 0.2, 0.8}},
+		{1, 0.5, {0.8, 0, 0}},
+		{1, 0.5, {-0.8, 0, 0}},
+		{1, 0.5, {1.3, 0, 0}},
+		{1, 0.5, {-1.3, 0, 0}},
+		{1, 0.5, {0.5, 0.1, -0.5}},
+		{1, 0.5, {-0.5, 0.1, -0.5}},
+		{1, 0.5, {0.5, 0.2, -1}},
+		{1, 0.5, {-0.5, 0.2, -1}},
+	}};
+	IndexedMesh body = marchingCubesIndexed(figure, 200, 200, 200, {-2, -2, -2}, {2, 2, 2});
+	std::vector<vec3> B;
+	for (unsigned int i : body.indices)
+		B.push_back(body.vertices[i]);
+
+	mat4 Projection = perspective(45, w / (float)h, 0.1, 100);
+	struct Scene
+	{
+		const char *name;
+		std::vector<vec3> P;
+		mat4 M;
+	};
+	Scene scenes[] = {
+		{"metaballs", B, Projection * lookAt({2.5, 2.5, 1.5}, {0, 0, 0}, {0, 0, 1})},
+		{"city", city_mesh(12, 8), Projection * lookAt({3, 1.6, 3}, {4, 1.5, 3.5}, {0, 1, 0})}};
+
+	for (const Scene &scene : scenes)
+	{
+		BenchShader shader;
+		shader.M = scene.M;
+		size_t n = scene.P.size() / 3, back = 0;
+		for (size_t i = 0; i < n; i++)
+		{
+			vec4 P[3];
+			for (int k = 0; k < 3; k++)
+				P[k] = scene.M * getPosition(scene.P[3 * i + k]);
+			back += clipSpaceArea(P[0], P[1], P[2]) < 0;
+		}
+
+		ImageRGB reference{w, h};
+		double t_none = 0;
+		for (Culling culling : {Culling{CULL_NONE, false}, Culling{CULL_BACK, false}, Culling{CULL_BACK, true}})
+		{
+			ImageRGB G{w, h};
+			double t = time_ms([&]
+			{
+				G.fill(white);
+				ImageZBuffer I{G};
+				Render3D(scene.P, Triangles{scene.P.size()}, shader, I, FRUSTUM_INTERSECTS, culling);
+			});
+
+			const char *mode = culling.face == CULL_NONE ? "none" : culling.before_clip ? "back before clip" : "back after clip";
+			if (culling.face == CULL_NONE)
+			{
+				reference = G;
+				t_none = t;
+				printf("backface %s: %zu triangles, %zu back facing\n", scene.name, n, back);
+			}
+
+			size_t different = 0;
+			for (int y = 0; y < h; y++)
+				for (int x = 0; x < w; x++)
+					different += memcmp(&reference(x, y), &G(x, y), sizeof(RGB)) != 0;
+			printf("backface %s %s: %.2f ms, %.2f Mtri/s (x%.2f), %zu pixels differ\n",
+				   scene.name, mode, t, n / t / 1000, t_none / t, different);
+		}
+	}
+}
+
+// Animação do bonecoMorcego: laço serial (desenha e grava cada quadro) contra o FrameSequence,
+// que desenha quadros em paralelo e grava os PNG em outras threads
+void bench_frame_sequence(int w, int h, int nframes)
+{
+	MetaballField figure{0.7, {
+		{1, 1.8, {0, 0, 0}},
+		{1, 0.7, {0, 0.2, 0.8}},
+		{1, 0.5, {0.8, 0, 0}},
+		{1, 0.5, {-0.8, 0, 0}},
+		{1, 0.5, {1.3, 0, 0}},
+		{1, 0.5, {-1.3, 0, 0}},
+	}};
+	IndexedMesh mesh = marchingCubesIndexed(figure, 100, 100, 100, {-2, -2, -2}, {2, 2, 2});
+	Elements<Triangles> T{mesh.indices};
+
+	mat4 M = perspective(45, w / (float)h, 0.1, 100) * lookAt({2.5, 2.5, 1.5}, {0, 0, 0}, {0, 0, 1});
+	std::string out = (std::filesystem::temp_directory_path() / "frame").string();
+	auto render = [&](int k, ImageRGB &G, ImageZBuffer &I)
+	{
+		G.fill(white);
+		BenchShader shader;
+		shader.M = M * rotate_z(k * 2 * M_PI / (nframes - 1));
+		Render3D(mesh.vertices, T, shader, I, FRUSTUM_INTERSECTS, {CULL_BACK});
+	};
+	auto save = [&](int k, const ImageRGB &G) { G.save_frame(k, out, "png"); };
+
+	double t_render = 0, t_save = 0;
+	double t_serial = time_ms([&]
+	{
+		ImageRGB G{w, h};
+		for (int k = 0; k < nframes; k++)
+		{
+			ImageZBuffer I{G};
+			t_render += time_ms([&] { render(k, G, I); }, 1);
+			t_save += time_ms([&] { save(k, G); }, 1);
+		}
+	}, 1);
+	printf("frames %d x %dx%d serial: %.1f ms (render %.1f ms, png %.1f ms)\n", nframes, w, h, t_serial, t_render, t_save);
+
+	FrameSequence<ImageZBuffer> sequence{w, h};
+	FrameTimes times = sequence.run(nframes, render, save);
+	double render_sum = 0, encode_sum = 0;
+	for (int k = 0; k < nframes; k++)
+	{
+		render_sum += times.render_ms[k];
+		encode_sum += times.encode_ms[k];
+	}
+	printf("frames %d x %dx%d FrameSequence (%u threads): %.1f ms (render %.1f ms, png %.1f ms) (x%.2f)\n",
+		   nframes, w, h, std::max(1u, std::thread::hardware_concurrency()), times.total_ms, render_sum, encode_sum,
+		   t_serial / times.total_ms);
+}
+
+// Medição por etapa (Profiler.h) de um quadro da cidade com o TiledRender3D e o ZBuffer hierárquico.
+// Também compara o tempo do quadro com a medição desligada e ligada.
+void bench_profiler(int w, int h)
+{
+	std::vector<vec3> P = city_mesh(12, 8);
+	BenchShader shader;
+	shader.M = perspective(45, w / (float)h, 0.1, 100) * lookAt({3, 1.6, 3}, {4, 1.5, 3.5}, {0, 1, 0});
+
+	ImageRGB G{w, h};
+	auto frame = [&]
+	{
+		G.fill(white);
+		ImageHiZBuffer I{G};
+		TiledRender3D(P, Triangles{P.size()}, shader, I, FRUSTUM_INTERSECTS, {CULL_BACK});
+	};
+
+	PipelineProfiler &profiler = pipelineProfiler();
+	profiler.enabled = false;
+	double t_off = time_ms(frame);
+
+	profiler.enabled = true;
+	profiler.trace = true;
+	profiler.reset();
+	double t_on = time_ms(frame, 1);
+	PipelineStats stats = profiler.stats();
+
+	std::string dir = std::filesystem::temp_directory_path().string();
+	profiler.writeJSON(dir + "/profile.json");
+	profiler.writeChromeTrace(dir + "/trace.json");
+	profiler.enabled = false;
+	profiler.trace = false;
+
+	printf("profiler city: %.2f ms, %.2f ms measured (x%.2f)\n", t_off, t_on, t_on / t_off);
+	double total = 0;
+	for (double ms : stats.stage_ms)
+		total += ms;
+	for (int i = 0; i < STAGE_COUNT; i++)
+		printf("profiler stage %-8s %8.2f ms %5.1f%%\n", stageName(i), stats.stage_ms[i], 100 * stats.stage_ms[i] / total);
+
+	const PipelineCounters &c = stats.counters;
+	printf("profiler primitives: %llu in, %llu culled, %llu outside, %llu clipped, %llu setups\n",
+		   (unsigned long long)c.primitives_in, (unsigned long long)c.primitives_culled,
+		   (unsigned long long)c.primitives_outside, (unsigned long long)c.primitives_clipped,
+		   (unsigned long long)c.primitive_setups);
+	printf("profiler fragments: %llu generated, %llu rejected, %llu written, overdraw %.2f\n",
+		   (unsigned long long)c.fragments_generated, (unsigned long long)c.fragments_rejected,
+		   (unsigned long long)c.fragments_written, stats.averageOverdraw());
+	printf("profiler: %s/profile.json, %s/trace.json\n", dir.c_str(), dir.c_str());
+}
+
+// Leitura do OBJ pelo ObjMesh e pelo ParallelObjMesh, que deve dar os mesmos triângulos e materiais
+void bench_obj_parser(int argc, char *argv[])
+{
+	std::vector<std::string> files = {synthetic_obj(500)};
+	files.insert(files.end(), argv + 1, argv + argc);
+
+	for (const std::string &obj : files)
+	{
+		std::vector<ObjMesh::Vertex> parsed;
+		std::vector<MaterialRange> parsed_materials;
+		double t_serial = time_ms([&]
+		{
+			ObjMesh mesh{obj};
+			parsed = mesh.getTriangles();
+			parsed_materials = mesh.getMaterials({});
+		}, 1);
+
+		std::vector<ObjMesh::Vertex> tris;
+		std::vector<MaterialRange> materials;
+		double t_parallel = time_ms([&]
+		{
+			ParallelObjMesh mesh{obj};
+			tris = mesh.getTriangles();
+			materials = mesh.getMaterials({});
+		});
+
+		size_t n = tris.size();
+		bool same = n == parsed.size() && memcmp(tris.data(), parsed.data(), n * sizeof(ObjMesh::Vertex)) == 0 &&
+					materials.size() == parsed_materials.size();
+		for (size_t i = 0; same && i < materials.size(); i++)
+			same = materials[i].first == parsed_materials[i].first && materials[i].count == parsed_materials[i].count &&
+				   materials[i].mat.map_Kd == parsed_materials[i].mat.map_Kd;
+
+		printf("%s: %zu vertices, ObjMesh %.1f ms, ParallelObjMesh %.1f ms (x%.1f, %u threads)%s\n", obj.c_str(), n,
+			   t_serial, t_parallel, t_serial / t_parallel, defaultThreadPool().size(), same ? "" : " DIFFERENT");
+	}
+}
+
+// malha regular indexada com os triângulos embaralhados:
+// desenho sem índices, com índices e com os índices reordenados para a cache de vértices
+void bench_vertex_cache(int w, int h)
+{
+	const int N = 300;
+	std::vector<vec3> P;
+	for (int j = 0; j < N; j++)
+		for (int i = 0; i < N; i++)
+			P.push_back({2.0f * i / (N - 1) - 1, 2.0f * j / (N - 1) - 1, 0.1f * sinf(0.2f * i) * cosf(0.3f * j)});
+
+	std::vector<std::array<unsigned int, 3>> quads;
+	for (int j = 0; j + 1 < N; j++)
+		for (int i = 0; i + 1 < N; i++)
+		{
+			unsigned int a = j * N + i, b = a + 1, c = a + N, d = c + 1;
+			quads.push_back({a, b, d});
+			quads.push_back({a, d, c});
+		}
+	std::shuffle(quads.begin(), quads.end(), std::mt19937{7});
+
+	std::vector<unsigned int> indices;
+	for (const auto &t : quads)
+		indices.insert(indices.end(), t.begin(), t.end());
+
+	std::vector<unsigned int> optimized;
+	double t_opt = time_ms([&] { optimized = optimizeVertexCache(indices, P.size()); }, 1);
+	printf("vertex cache ACMR shuffled: %.3f, optimized: %.3f (%.2f ms)\n", acmr(indices), acmr(optimized), t_opt);
+
+	std::vector<vec3> flat;
+	for (unsigned int i : indices)
+		flat.push_back(P[i]);
+
+	CountingShader shader;
+	mat4 View = lookAt({0, -1.5, 2}, {0, 0, 0}, {0, 1, 0});
+	mat4 Projection = perspective(45, w / (float)h, 0.1, 100);
+	shader.M = Projection * View;
+
+	auto run = [&](const char *name, auto &V, auto T)
+	{
+		ImageRGB G{w, h};
+		double t = time_ms([&]
+		{
+			shader.vertices = 0;
+			G.fill(white);
+			ImageZBuffer I{G};
+			Render3D(V, T, shader, I);
+		});
+		printf("vertex cache %s: %.2f ms, %zu vertexShader calls for %zu triangles\n", name, t, shader.vertices, quads.size());
+	};
+	run("Triangles", flat, Triangles{flat.size()});
+	run("Elements shuffled", P, Elements<Triangles>{indices});
+	run("Elements optimized", P, Elements<Triangles>{optimized});
+}
+
+// estágio de vértices com as posições em std::vector<vec3> e em VertexArraySoA (vertexShader em lote)
+void bench_soa(int w, int h)
+{
+	std::vector<vec3> P = random_triangles(125000 / 3, 0.05);
+	VertexArraySoA S{P};
+	Triangles T{P.size()};
+
+	SimpleShader shader;
+	shader.M = perspective(45, w / (float)h, 0.1, 100) * lookAt({0, 0, 3}, {0, 0, 0}, {0, 1, 0});
+	ImageRGB G{w, h};
+
+	size_t n = 0;
+	auto count = [&](const auto &primitives) { n += primitives.size(); };
+
+	Render3D<std::vector<vec3>, Triangles, SimpleShader, ImageRGB> aos{shader, G};
+	double t_aos = time_ms([&] { aos.forEachBatch(P, T, aos.batch_size, count); });
+	printf("vertex stage std::vector<vec3>: %.3f ms, %zu vertices\n", t_aos, P.size());
+
+	Render3D<VertexArraySoA, Triangles, SimpleShader, ImageRGB> soa{shader, G};
+	double t_soa = time_ms([&] { soa.forEachBatch(S, T, soa.batch_size, count); });
+	printf("vertex stage VertexArraySoA: %.3f ms (x%.2f)\n", t_soa, t_aos / t_soa);
+}
+
+struct FloorVertex
+{
+	vec3 position;
+	vec2 texCoords;
+};
+
+// diferença média por canal (0 a 1) entre G e a média de cada bloco s x s de R
+double mean_difference(const ImageRGB &G, const ImageRGB &R, int s)
+{
+	double sum = 0;
+	for (int y = 0; y < G.height(); y++)
+		for (int x = 0; x < G.width(); x++)
+		{
+			vec3 c = {0, 0, 0};
+			for (int j = 0; j < s; j++)
+				for (int i = 0; i < s; i++)
+					c = c + toVec(R(s * x + i, s * y + j));
+			vec3 d = toVec(G(x, y)) - (1.0f / (s * s)) * c;
+			sum += fabs(d[0]) + fabs(d[1]) + fabs(d[2]);
+		}
+	return sum / (3.0 * G.width() * G.height());
+}
+
+// Chão xadrez repetido 35 vezes, visto de lado e girado: texturas muito reduzidas perto do horizonte.
+// Compara o erro de cada filtro contra uma referência com 4x4 amostras por pixel.
+void bench_texture_filter(int w, int h)
+{
+	ImageRGB checker{512, 512};
+	for (int y = 0; y < 512; y++)
+		for (int x = 0; x < 512; x++)
+			checker(x, y) = ((x / 8 + y / 8) % 2) ? toColor(vec3{0.9, 0.85, 0.7}) : toColor(vec3{0.15, 0.2, 0.3});
+
+	std::vector<FloorVertex> V = {
+		{{-1, 0, -1}, {0, 0}}, {{1, 0, -1}, {35, 0}}, {{1, 0, 1}, {35, 35}},
+		{{-1, 0, -1}, {0, 0}}, {{1, 0, 1}, {35, 35}}, {{-1, 0, 1}, {0, 35}}};
+	Triangles T{V.size()};
+
+	mat4 View = lookAt({0, 1.6, 5}, {0, 1.6, 0}, {0, 1, 0});
+	mat4 Model = rotate_y(0.6) * scale(35, 35, 35);
+
+	auto render = [&](const Sampler2D &texture, int rw, int rh, ImageRGB &G)
+	{
+		TextureLODShader shader;
+		shader.M = perspective(45, rw / (float)rh, 0.1, 1000) * View * Model;
+		shader.texture = &texture;
+		G.fill(0x00A5DC_rgb);
+		Render3D(V, T, shader, G);
+	};
+
+	Sampler2D bilinear;
+	bilinear.img = checker;
+	bilinear.filter = BILINEAR;
+	bilinear.wrapX = bilinear.wrapY = REPEAT;
+
+	const int s = 4;
+	ImageRGB R{s * w, s * h};
+	render(bilinear, s * w, s * h, R);
+
+	Sampler2D trilinear = bilinear;
+	trilinear.filter = TRILINEAR;
+	double t_mip = time_ms([&] { trilinear.generateMipmaps(); }, 1);
+	printf("mipmaps %dx%d: %.3f ms, %d levels\n", checker.width(), checker.height(), t_mip, trilinear.levels());
+
+	Sampler2D aniso = trilinear;
+	aniso.max_anisotropy = 16;
+
+	std::pair<const char *, const Sampler2D *> filters[] = {
+		{"bilinear", &bilinear}, {"trilinear", &trilinear}, {"trilinear + anisotropic x16", &aniso}};
+	for (auto [name, texture] : filters)
+	{
+		ImageRGB G{w, h};
+		double t = time_ms([&] { render(*texture, w, h, G); });
+		printf("floor %s: %.3f ms, error %.4f\n", name, t, mean_difference(G, R, s));
+	}
+}
+
+// Leitura de uma textura 2048x2048 (16 MB em 4 bytes por texel) por uma tela girada,
+// 3 texels por pixel e sem mipmaps, e o chão do bench_texture_filter com a mesma textura:
+// compara as organizações dos texels na memória.
+void bench_texture_layout(int w, int h)
+{
+	const int n = 2048;
+	std::mt19937 rng{1234};
+	ImageRGB img{n, n};
+	for (int y = 0; y < n; y++)
+		for (int x = 0; x < n; x++)
+			img(x, y) = RGB{(unsigned char)rng(), (unsigned char)rng(), (unsigned char)rng()};
+
+	Sampler2D texture;
+	texture.img = img;
+	texture.wrapX = texture.wrapY = REPEAT;
+
+	std::pair<const char *, TexelLayout> layouts[] = {
+		{"row-major", ROW_MAJOR}, {"tiled 4x4", TILED_4x4}, {"morton", MORTON}};
+
+	std::vector<RGB> reference(w * h), out(w * h);
+	for (Filter filter : {NEAREST, BILINEAR})
+	{
+		texture.filter = filter;
+		for (float degrees : {0.0f, 30.0f, 90.0f})
+		{
+			float a = degrees * M_PI / 180;
+			vec2 du = (3.0f / n) * vec2{cosf(a), sinf(a)};
+			vec2 dv = (3.0f / n) * vec2{-sinf(a), cosf(a)};
+
+			for (auto [name, layout] : layouts)
+			{
+				texture.setLayout(layout);
+				double t = time_ms([&]
+				{
+					// em blocos de 8x8 pixels, como o rasterizador
+					for (int by = 0; by < h; by += 8)
+						for (int bx = 0; bx < w; bx += 8)
+							for (int y = by; y < std::min(by + 8, h); y++)
+								for (int x = bx; x < std::min(bx + 8, w); x++)
+									out[y * w + x] = texture.sample((x + 0.3f) * du + (y + 0.3f) * dv);
+				});
+				if (layout == ROW_MAJOR)
+					reference = out;
+				bool same = memcmp(out.data(), reference.data(), out.size() * sizeof(RGB)) == 0;
+				printf("%s rotated %2.0f° %-10s: %.3f ms, %.1f Msamples/s%s\n", filter == NEAREST ? "nearest" : "bilinear",
+					   degrees, name, t, w * h / (1000 * t), same ? "" : " (DIFFERENT)");
+			}
+		}
+	}
+
+	std::vector<FloorVertex> V = {
+		{{-1, 0, -1}, {0, 0}}, {{1, 0, -1}, {8, 0}}, {{1, 0, 1}, {8, 8}},
+		{{-1, 0, -1}, {0, 0}}, {{1, 0, 1}, {8, 8}}, {{-1, 0, 1}, {0, 8}}};
+	Triangles T{V.size()};
+	TextureLODShader shader;
+	shader.M = perspective(45, w / (float)h, 0.1, 1000) * lookAt({0, 1.6, 5}, {0, 1.6, 0}, {0, 1, 0}) *
+			   rotate_y(0.6) * scale(35, 35, 35);
+	shader.texture = &texture;
+
+	texture.filter = TRILINEAR;
+	texture.generateMipmaps();
+	ImageRGB R{w, h};
+	for (auto [name, layout] : layouts)
+	{
+		texture.setLayout(layout);
+		ImageRGB G{w, h};
+		double t = time_ms([&] { Render3D(V, T, shader, G); });
+		if (layout == ROW_MAJOR)
+			R = G;
+		printf("floor trilinear %-10s: %.3f ms%s\n", name, t, same_pixels(G, R) ? "" : " (DIFFERENT)");
+	}
+}
+
+// o mesmo shader, sem a versão em lote do fragmentShader
+struct PerFragmentTextureShader : BatchTextureShader
+{
+	void fragmentShader(Varying V, RGB &fragColor)
+	{
+		BatchTextureShader::fragmentShader(V, fragColor);
+	}
+};
+
+// Sampler2D::sample por fragmento contra sample8, sozinhos e no chão texturizado
+void bench_texture_batch(int w, int h)
+{
+	const int n = 1024;
+	std::mt19937 rng{1234};
+	ImageRGB img{n, n};
+	for (int y = 0; y < n; y++)
+		for (int x = 0; x < n; x++)
+			img(x, y) = RGB{(unsigned char)rng(), (unsigned char)rng(), (unsigned char)rng()};
+
+	Sampler2D texture;
+	texture.img = img;
+
+	float a = 0.5;
+	vec2 du = (1.3f / n) * vec2{cosf(a), sinf(a)};
+	vec2 dv = (1.3f / n) * vec2{-sinf(a), cosf(a)};
+	std::vector<float> U(w * h), V(w * h);
+	for (int y = 0; y < h; y++)
+		for (int x = 0; x < w; x++)
+		{
+			vec2 uv = (x - w / 2 + 0.3f) * du + (y - h / 2 + 0.3f) * dv;
+			U[y * w + x] = uv[0];
+			V[y * w + x] = uv[1];
+		}
+
+	std::tuple<const char *, Filter, WrapMode> modes[] = {
+		{"nearest clamp", NEAREST, CLAMP}, {"bilinear repeat", BILINEAR, REPEAT}, {"bilinear mirrored", BILINEAR, MIRRORED_REPEAT}};
+	std::vector<RGB> A(w * h), B(w * h);
+	for (auto [name, filter, wrap] : modes)
+	{
+		texture.filter = filter;
+		texture.wrapX = texture.wrapY = wrap;
+		double t1 = time_ms([&]
+		{
+			for (int i = 0; i < w * h; i++)
+				A[i] = texture.sample({U[i], V[i]});
+		});
+		double t8 = time_ms([&]
+		{
+			for (int i = 0; i < w * h; i += 8)
+				texture.sample8(&U[i], &V[i], &B[i], std::min(8, w * h - i));
+		});
+
+		int max_difference = 0;
+		const unsigned char *a = reinterpret_cast<const unsigned char *>(A.data());
+		const unsigned char *b = reinterpret_cast<const unsigned char *>(B.data());
+		for (size_t i = 0; i < A.size() * sizeof(RGB); i++)
+			max_difference = std::max(max_difference, abs(a[i] - b[i]));
+		printf("%-17s sample: %.1f Msamples/s, sample8: %.1f Msamples/s (x%.2f), max difference %d\n", name,
+			   w * h / (1000 * t1), w * h / (1000 * t8), t1 / t8, max_difference);
+	}
+
+	std::vector<FloorVertex> F = {
+		{{-1, 0, -1}, {0, 0}}, {{1, 0, -1}, {35, 0}}, {{1, 0, 1}, {35, 35}},
+		{{-1, 0, -1}, {0, 0}}, {{1, 0, 1}, {35, 35}}, {{-1, 0, 1}, {0, 35}}};
+	Triangles T{F.size()};
+	mat4 M = perspective(45, w / (float)h, 0.1, 1000) * lookAt({0, 1.6, 5}, {0, 1.6, 0}, {0, 1, 0}) *
+			 rotate_y(0.6) * scale(35, 35, 35);
+	texture.filter = BILINEAR;
+	texture.wrapX = texture.wrapY = REPEAT;
+
+	PerFragmentTextureShader single;
+	single.M = M;
+	single.texture = &texture;
+	ImageRGB G1{w, h};
+	double t1 = time_ms([&] { Render3D(F, T, single, G1); });
+
+	BatchTextureShader batch;
+	batch.M = M;
+	batch.texture = &texture;
+	ImageRGB G8{w, h};
+	double t8 = time_ms([&] { Render3D(F, T, batch, G8); });
+	printf("floor bilinear per fragment: %.3f ms, batched: %.3f ms (x%.2f)\n", t1, t8, t1 / t8);
+}
+
+// Troca de textura por faixa de material: cópia do ImageRGB para o Sampler2D (como o bonecosglfw fazia)
+// contra Sampler2D::bind de uma textura do TextureStore; e o descarte pelo orçamento de memória.
+void bench_texture_store(int meshes, int textures, int size)
+{
+	TextureStore store;
+	std::vector<std::shared_ptr<const Texture>> handles; // textura de cada faixa de material
+	for (int m = 0; m < meshes; m++)
+		for (int t = 0; t < textures; t++)
+		{
+			std::string name = "texture" + std::to_string(t);
+			auto texture = store.find(name);
+			if (!texture)
+			{
+				ImageRGB img{size, size};
+				img.fill(toColor(vec3{t / (float)textures, 0.5, 0.5}));
+				texture = store.add(name, std::move(img));
+			}
+			handles.push_back(texture);
+		}
+
+	// antes cada malha tinha o seu ImageSet, com uma cópia decodificada de cada textura (sem mipmaps)
+	printf("%zu material ranges, %d textures %dx%d: store with mipmaps %.1f MB, one image per mesh %.1f MB\n",
+		   handles.size(), textures, size, size, store.memory() / 1e6, handles.size() * size * size * sizeof(RGB) / 1e6);
+
+	Sampler2D sampler;
+	double t_copy = time_ms([&]
+	{
+		for (const auto &texture : handles)
+			sampler.img = texture->img;
+	});
+	double t_bind = time_ms([&]
+	{
+		for (const auto &texture : handles)
+			sampler.bind(texture.get());
+	});
+	printf("binding all ranges: copy %.3f ms, bind %.6f ms\n", t_copy, t_bind);
+
+	// orçamento menor que o total: as texturas sem uso são descartadas
+	handles.resize(textures / 8);
+	size_t budget = store.memory() / 4;
+	store.setBudget(budget);
+	printf("budget %.1f MB: %zu textures kept, %zu in use, %.1f MB\n", budget / 1e6, store.size(), handles.size(),
+		   store.memory() / 1e6);
+}
+
+// união de esferas: f = min(|p - c| - r)
+struct SpheresField
+{
+	std::vector<vec4> spheres; // centro e raio
+
+	float operator()(float x, float y, float z) const
+	{
+		float f = INFINITY;
+		for (vec4 s : spheres)
+			f = std::min(f, norm(vec3{x - s[0], y - s[1], z - s[2]}) - s[3]);
+		return f;
+	}
+};
+
+// mesma figura, com limites do campo para a octree
+struct SpheresFieldRange : SpheresField
+{
+	std::pair<float, float> range(vec3 lo, vec3 hi) const
+	{
+		float fmin = INFINITY, fmax = INFINITY;
+		for (vec4 s : spheres)
+		{
+			vec3 near, far;
+			for (int i = 0; i < 3; i++)
+			{
+				near[i] = clamp(s[i], lo[i], hi[i]);
+				far[i] = s[i] - lo[i] > hi[i] - s[i] ? lo[i] : hi[i];
+			}
+			fmin = std::min(fmin, norm(near - toVec3(s)) - s[3]);
+			fmax = std::min(fmax, norm(far - toVec3(s)) - s[3]);
+		}
+		return {fmin, fmax};
+	}
+};
+
+void bench_marching_cubes(int n)
+{
+	std::mt19937 rng{17};
+	std::uniform_real_distribution<float> U{-1.5, 1.5}, R{0.1, 0.4};
+	SpheresFieldRange field;
+	for (int i = 0; i < 20; i++)
+		field.spheres.push_back({U(rng), U(rng), U(rng), R(rng)});
+
+	vec3 pmin = {-2, -2, -2}, pmax = {2, 2, 2};
+
+	// referência: o campo calculado nos 8 cantos de cada célula, como no marching cubes simples
+	size_t changes = 0;
+	double t_naive = time_ms([&]
+	{
+		changes = 0;
+		vec3 d = (1.0f / n) * (pmax - pmin);
+		for (int k = 0; k < n; k++)
+			for (int j = 0; j < n; j++)
+				for (int i = 0; i < n; i++)
+				{
+					int m = 0;
+					for (int c = 0; c < 8; c++)
+						m |= (field(pmin[0] + (i + (c & 1)) * d[0], pmin[1] + (j + (c >> 1 & 1)) * d[1],
+									pmin[2] + (k + (c >> 2 & 1)) * d[2]) < 0) << c;
+					changes += m != 0 && m != 255;
+				}
+	}, 1);
+	printf("marching cubes %d^3 field at cell corners: %.1f ms, %zu cells on the surface\n", n, t_naive, changes);
+
+	IndexedMesh mesh;
+	ThreadPool single{1};
+	double t_one = time_ms([&] { mesh = marchingCubesIndexed((const SpheresField &)field, n, n, n, pmin, pmax, single); }, 1);
+	printf("marching cubes %d^3 slab cache, 1 thread: %.1f ms, %zu vertices, %zu triangles\n",
+		   n, t_one, mesh.vertices.size(), mesh.indices.size() / 3);
+
+	double t_all = time_ms([&] { mesh = marchingCubesIndexed((const SpheresField &)field, n, n, n, pmin, pmax); }, 1);
+	printf("marching cubes %d^3 slab cache, %u threads: %.1f ms\n", n, defaultThreadPool().size(), t_all);
+
+	double t_octree = time_ms([&] { mesh = marchingCubesIndexed(field, n, n, n, pmin, pmax); }, 1);
+	printf("marching cubes %d^3 slab cache + octree, %u threads: %.1f ms (x%.1f), %zu vertices\n",
+		   n, defaultThreadPool().size(), t_octree, t_naive / t_octree, mesh.vertices.size());
+}
+
+// campo de milhares de metaballs: soma de todos, grade uniforme e linhas em lote
+void bench_metaballs(int nballs, int n)
+{
+	std::mt19937 rng{23};
+	std::uniform_real_distribution<float> U{-1.5, 1.5}, R{0.1, 0.35};
+	std::vector<Metaball> balls;
+	for (int i = 0; i < nballs; i++)
+		balls.push_back({1, R(rng), {U(rng), U(rng), U(rng)}});
+
+	MetaballField field{0.5, balls};
+	float d = 4.0f / n;
+	std::vector<float> values((n + 1) * (n + 1) * (n + 1));
+
+	double t_all = time_ms([&]
+	{
+		float *out = values.data();
+		for (int k = 0; k <= n; k++)
+			for (int j = 0; j <= n; j++)
+				for (int i = 0; i <= n; i++)
+				{
+					vec3 P = {-2 + i * d, -2 + j * d, -2 + k * d};
+					float sum = 0;
+					for (const Metaball &m : balls)
+						sum += m(P);
+					*out++ = field.T - sum;
+				}
+	}, 1);
+	printf("metaballs %d, %d^3 points, all balls: %.1f ms\n", nballs, n + 1, t_all);
+
+	double t_grid = time_ms([&]
+	{
+		float *out = values.data();
+		for (int k = 0; k <= n; k++)
+			for (int j = 0; j <= n; j++)
+				for (int i = 0; i <= n; i++)
+					*out++ = field(-2 + i * d, -2 + j * d, -2 + k * d);
+	}, 1);
+	printf("metaballs %d, %d^3 points, uniform grid: %.1f ms (x%.1f)\n", nballs, n + 1, t_grid, t_all / t_grid);
+
+	double t_row = time_ms([&]
+	{
+		float *out = values.data();
+		for (int k = 0; k <= n; k++)
+			for (int j = 0; j <= n; j++, out += n + 1)
+				field.evalRow(-2, d, 0, n + 1, -2 + j * d, -2 + k * d, out);
+	}, 1);
+	printf("metaballs %d, %d^3 points, evalRow: %.1f ms (x%.1f)\n", nballs, n + 1, t_row, t_all / t_row);
+
+	IndexedMesh mesh;
+	double t_mc = time_ms([&] { mesh = marchingCubesIndexed(field, 256, 256, 256, {-2, -2, -2}, {2, 2, 2}); }, 1);
+	printf("metaballs %d, marching cubes 256^3: %.1f ms, %zu triangles\n", nballs, t_mc, mesh.indices.size() / 3);
+}
+
+// muitas camadas de triângulos grandes, da frente para trás
+void bench_hiz(int w, int h)
+{
+	std::vector<vec3> P = random_triangles(4000, 0.4);
+	for (unsigned int i = 0; i < P.size(); i += 3)
+	{
+		float z = -1 + 2 * (i / (float)P.size());
+		for (int j = 0; j < 3; j++)
+			P[i + j][2] = z;
+	}
+	Triangles T{P.size()};
+
+	BenchShader shader;
+	mat4 View = lookAt({0, 0, 3}, {0, 0, 0}, {0, 1, 0});
+	mat4 Projection = perspective(45, w / (float)h, 0.1, 100);
+	shader.M = Projection * View;
+
+	ImageRGB A{w, h};
+	double t_z = time_ms([&]
+	{
+		A.fill(white);
+		ImageZBuffer I{A};
+		Render3D(P, T, shader, I);
+	});
+	printf("hiz ZBuffer: %.2f ms\n", t_z);
+
+	ImageRGB B{w, h};
+	HiZStats stats;
+	double t_hiz = time_ms([&]
+	{
+		B.fill(white);
+		ImageHiZBuffer I{B};
+		Render3D(P, T, shader, I);
+		stats = I.stats();
+	});
+	printf("hiz HiZBuffer: %.2f ms (x%.2f) %s\n", t_hiz, t_z / t_hiz, same_pixels(A, B) ? "ok" : "DIFFERENT");
+	printf("hiz triangles culled %zu/%zu, blocks culled %zu/%zu (%zu in front), fragments culled %zu/%zu\n",
+		   stats.triangles_culled, stats.triangles_tested,
+		   stats.blocks_culled, stats.blocks_tested, stats.blocks_in_front,
+		   stats.fragments_culled, stats.fragments_tested);
+}
+
+// conta as chamadas do fragmentShader
+struct FragmentCountingShader : BenchShader
+{
+	size_t fragments = 0;
+
+	void fragmentShader(Varying V, RGB &FragColor)
+	{
+		fragments++;
+		BenchShader::fragmentShader(V, FragColor);
+	}
+};
+
+// média dos blocos de k x k pixels de A
+ImageRGB downsample(const ImageRGB &A, int k)
+{
+	ImageRGB B{A.width() / k, A.height() / k};
+	for (int y = 0; y < B.height(); y++)
+		for (int x = 0; x < B.width(); x++)
+		{
+			int sum[3] = {0, 0, 0};
+			for (int j = 0; j < k; j++)
+				for (int i = 0; i < k; i++)
+				{
+					const unsigned char *c = reinterpret_cast<const unsigned char *>(&A(k * x + i, k * y + j));
+					for (int n = 0; n < 3; n++)
+						sum[n] += c[n];
+				}
+			unsigned char *c = reinterpret_cast<unsigned char *>(&B(x, y));
+			for (int n = 0; n < 3; n++)
+				c[n] = (sum[n] + k * k / 2) / (k * k);
+		}
+	return B;
+}
+
+// diferença média por canal entre A e B
+double mean_error(const ImageRGB &A, const ImageRGB &B)
+{
+	const unsigned char *a = reinterpret_cast<const unsigned char *>(A.data());
+	const unsigned char *b = reinterpret_cast<const unsigned char *>(B.data());
+	size_t n = 3 * (size_t)A.width() * A.height();
+	double sum = 0;
+	for (size_t i = 0; i < n; i++)
+		sum += abs(a[i] - b[i]);
+	return sum / n;
+}
+
+// ImageFrameBuffer (32 bits por pixel, fast clear) contra ImageRGB com ImageZBuffer:
+// a limpeza, um quadro com poucos triângulos (a maior parte da tela só limpa) e um cheio
+void bench_framebuffer(int w, int h)
+{
+	ImageRGB A{w, h};
+	std::vector<float> depth(w * h);
+	double t_fill = time_ms([&]
+	{
+		A.fill(white);
+		std::fill(depth.begin(), depth.end(), 1.0f);
+	});
+
+	ImageFrameBuffer F{w, h};
+	double t_fast = time_ms([&]
+	{
+		F.fill(white);
+		F.clear();
+	});
+	double t_avx = time_ms([&]
+	{
+		F.fill(white);
+		F.clear();
+		F.pixels();
+		for (int y = 0; y < h; y += ImageFrameBuffer::tile_size)
+			for (int x = 0; x < w; x += ImageFrameBuffer::tile_size)
+				F.testFragment({x, y}, 1, DEPTH_PASS);
+	});
+	ImageRGB B;
+	double t_read = time_ms([&] { F.readRGB(B); });
+	printf("framebuffer clear: ImageRGB + ZBuffer %.2f ms, fast clear %.3f ms, AVX clear %.2f ms, readRGB %.2f ms\n",
+		   t_fill, t_fast, t_avx, t_read);
+
+	mat4 View = lookAt({0, 0, 3}, {0, 0, 0}, {0, 1, 0});
+	mat4 Projection = perspective(45, w / (float)h, 0.1, 100);
+	BenchShader shader;
+	shader.M = Projection * View;
+
+	for (auto [name, n, size] : {std::tuple{"sparse", 200, 0.05f}, std::tuple{"full", 20000, 0.1f}})
+	{
+		std::vector<vec3> P = random_triangles(n, size);
+		Triangles T{P.size()};
+
+		double t_rgb = time_ms([&]
+		{
+			A.fill(white);
+			ImageZBuffer I{A};
+			TiledRender3D(P, T, shader, I);
+		});
+		double t_fb = time_ms([&]
+		{
+			F.fill(white);
+			F.clear();
+			TiledRender3D(P, T, shader, F);
+			F.readRGB(B);
+		});
+		printf("framebuffer %-6s ImageRGB + ZBuffer: %.2f ms, ImageFrameBuffer + readRGB: %.2f ms (x%.2f) %s\n", name,
+			   t_rgb, t_fb, t_rgb / t_fb, same_pixels(A, B) ? "ok" : "DIFFERENT");
+	}
+}
+
+// Multiamostragem (Multisample.h) contra uma amostra por pixel: o fragmentShader deve rodar
+// o mesmo número de vezes, e as bordas devem se aproximar de uma imagem com 16 amostras por pixel
+// (desenhada em 4x a resolução e reduzida)
+void bench_msaa(int w, int h)
+{
+	std::vector<vec3> P = random_triangles(2000, 0.2);
+	Triangles T{P.size()};
+	mat4 View = lookAt({0, 0, 3}, {0, 0, 0}, {0, 1, 0});
+	mat4 Projection = perspective(45, w / (float)h, 0.1, 100);
+
+	FragmentCountingShader shader;
+	shader.M = Projection * View;
+
+	ImageRGB A{w, h};
+	size_t fragments_1x = 0;
+	double t_1x = time_ms([&]
+	{
+		A.fill(white);
+		ImageZBuffer I{A};
+		shader.fragments = 0;
+		TiledRender3D(P, T, shader, I);
+		fragments_1x = shader.fragments;
+	});
+	printf("msaa 1x: %.2f ms, %zu fragment shader calls\n", t_1x, fragments_1x);
+
+	ImageRGB reference{4 * w, 4 * h};
+	reference.fill(white);
+	{
+		ImageZBuffer I{reference};
+		TiledRender3D(P, T, shader, I);
+	}
+	reference = downsample(reference, 4);
+
+	for (int samples : {2, 4, 8})
+	{
+		ImageRGB B{w, h};
+		size_t fragments = 0;
+		double t_resolve = 1e30;
+		double t = time_ms([&]
+		{
+			ImageMultisample I{B, samples};
+			I.fill(white);
+			shader.fragments = 0;
+			TiledRender3D(P, T, shader, I);
+			fragments = shader.fragments;
+			t_resolve = std::min(t_resolve, time_ms([&] { I.resolve(); }, 1));
+		});
+		printf("msaa %dx: %.2f ms (x%.2f, resolve %.2f ms), %zu fragment shader calls (x%.2f), "
+			   "error against 16 samples %.3f (1x: %.3f)\n",
+			   samples, t, t / t_1x, t_resolve, fragments, fragments / (double)fragments_1x,
+			   mean_error(B, reference), mean_error(A, reference));
+	}
+}
+
+using ScreenTriangle = std::array<vec2, 3>;
+using ScreenLine = std::array<vec2, 2>;
+
+// n triângulos com o centro em [x0, x1) x [y0, y1) e os vértices a até r pixels do centro
+std::vector<ScreenTriangle> screen_triangles(BenchRandom &U, int n, float x0, float y0, float x1, float y1, float r)
+{
+	std::vector<ScreenTriangle> T(n);
+	for (ScreenTriangle &t : T)
+	{
+		vec2 c = {U(x0, x1), U(y0, y1)};
+		for (vec2 &v : t)
+			v = c + vec2{U(-r, r), U(-r, r)};
+	}
+	return T;
+}
+
+// triângulos longos e finos (len x width pixels) em direções aleatórias, dentro da tela
+std::vector<ScreenTriangle> sliver_triangles(BenchRandom &U, int n, int w, int h, float len, float width)
+{
+	std::vector<ScreenTriangle> T(n);
+	for (ScreenTriangle &t : T)
+	{
+		float a = U(0, 2 * M_PI);
+		vec2 d = 0.5f * len * vec2{cosf(a), sinf(a)};
+		vec2 e = 0.5f * width * vec2{-sinf(a), cosf(a)};
+		vec2 c = {U(len / 2, w - len / 2), U(len / 2, h - len / 2)};
+		t = {c - d - e, c + d, c - d + e};
+	}
+	return T;
+}
+
+// segmentos dentro da tela com até len pixels em x e em y
+std::vector<ScreenLine> screen_lines(BenchRandom &U, int n, int w, int h, float len)
+{
+	std::vector<ScreenLine> L(n);
+	for (ScreenLine &l : L)
+	{
+		l[0] = {U(0, w - 1), U(0, h - 1)};
+		l[1] = {(float)clamp(l[0][0] + U(-len, len), 0, w - 1), (float)clamp(l[0][1] + U(-len, len), 0, h - 1)};
+	}
+	return L;
+}
+
+// quadrados texturizados de lado size, em posições e orientações aleatórias no cubo [-1,1]³
+std::vector<FloorVertex> textured_quads(BenchRandom &U, int n, float size)
+{
+	std::vector<FloorVertex> V;
+	for (int i = 0; i < n; i++)
+	{
+		vec3 c = {U(-1, 1), U(-1, 1), U(-1, 1)};
+		mat4 R = rotate_z(U(0, 2 * M_PI)) * rotate_y(U(0, 2 * M_PI)) * rotate_x(U(0, 2 * M_PI));
+		vec3 u = toVec3(R * vec4{size, 0, 0, 0}), v = toVec3(R * vec4{0, size, 0, 0});
+		FloorVertex A = {c - 0.5f * (u + v), {0, 0}}, B = {c + 0.5f * (u - v), {1, 0}};
+		FloorVertex C = {c + 0.5f * (u + v), {1, 1}}, D = {c - 0.5f * (u - v), {0, 1}};
+		V.insert(V.end(), {A, B, C, A, C, D});
+	}
+	return V;
+}
+
+// fragmentos gerados por uma execução de f, contados pelo Profiler.h
+template <class F>
+uint64_t count_fragments(F f)
+{
+	PipelineProfiler &profiler = pipelineProfiler();
+	profiler.enabled = true;
+	profiler.reset();
+	f();
+	profiler.enabled = false;
+	return profiler.stats().counters.fragments_generated;
+}
+
+// Suíte reprodutível (benchmark --suite): cargas sintéticas com sementes fixas, as mesmas em toda execução,
+// medidas em milhões de primitivas e de pixels por segundo e gravadas em JSON para acompanhar regressões.
+// Cada medida é o menor tempo de 3 execuções. Nos pipelines, os pixels são os fragmentos gerados.
+void bench_suite(BenchReport &report)
+{
+	const int w = report.width, h = report.height, reps = 3;
+	PixelRect R = {0, 0, w, h};
+	ImageRGB G{w, h};
+	auto plot = [&](Pixel p)
+	{
+		if (R.has(p))
+			G(p.x, p.y) = white;
+	};
+
+	// f() devolve o número de pixels
+	auto measure = [&](const std::string &name, uint64_t primitives, auto f)
+	{
+		uint64_t pixels = 0;
+		double ms = time_ms([&] { pixels = f(); }, reps);
+		report.add(name, ms, primitives, pixels);
+	};
+
+	// rasterizadores de triângulos
+	BenchRandom U{2024};
+	std::pair<const char *, std::vector<ScreenTriangle>> triangle_loads[] = {
+		{"tiny", screen_triangles(U, 200000, 0, 0, w, h, 3)},
+		{"huge", screen_triangles(U, 64, 0.5f * w, 0.5f * h, 0.5f * w, 0.5f * h, 0.5f * std::min(w, h))},
+		{"slivers", sliver_triangles(U, 10000, w, h, 0.25f * std::min(w, h), 0.7f)}};
+	for (const auto &[load, T] : triangle_loads)
+	{
+		measure(std::string("raster/edge/") + load, T.size(), [&]
+		{
+			uint64_t n = 0;
+			for (const ScreenTriangle &t : T)
+				rasterizeTriangle(t, R, [&](Pixel p, vec3) { plot(p), n++; });
+			return n;
+		});
+		measure(std::string("raster/scanline/") + load, T.size(), [&]
+		{
+			uint64_t n = 0;
+			for (const ScreenTriangle &t : T)
+				scanline(t, R, [&](Pixel p) { plot(p), n++; });
+			return n;
+		});
+		measure(std::string("raster/simple/") + load, T.size(), [&]
+		{
+			uint64_t n = 0;
+			for (const ScreenTriangle &t : T)
+				simple_rasterize_triangle(t, [&](Pixel p) { plot(p), n++; });
+			return n;
+		});
+	}
+
+	// rasterizadores de linhas
+	std::pair<const char *, std::vector<ScreenLine>> line_loads[] = {
+		{"short", screen_lines(U, 200000, w, h, 16)},
+		{"long", screen_lines(U, 20000, w, h, w)}};
+	for (const auto &[load, L] : line_loads)
+	{
+		measure(std::string("line/dda/") + load, L.size(), [&]
+		{
+			uint64_t n = 0;
+			for (const ScreenLine &l : L)
+				dda(l[0], l[1], [&](Pixel p) { plot(p), n++; });
+			return n;
+		});
+		measure(std::string("line/bresenham/") + load, L.size(), [&]
+		{
+			uint64_t n = 0;
+			for (const ScreenLine &l : L)
+				bresenham(toPixel(l[0]), toPixel(l[1]), [&](Pixel p) { plot(p), n++; });
+			return n;
+		});
+		measure(std::string("line/simple/") + load, L.size(), [&]
+		{
+			uint64_t n = 0;
+			for (const ScreenLine &l : L)
+				simple(l[0], l[1], [&](Pixel p) { plot(p), n++; });
+			return n;
+		});
+	}
+
+	// recorte 2D: primitivas grandes em volta da tela, boa parte cruzando as bordas
+	ClipRectangle rect = {-0.5f, -0.5f, w - 0.5f, h - 0.5f};
+	using Vertex2D = PosCol<vec2>; // como no render2d
+	std::vector<Triangle<Vertex2D>> offscreen;
+	for (const ScreenTriangle &t : screen_triangles(U, 50000, -0.5f * w, -0.5f * h, 1.5f * w, 1.5f * h, 0.3f * w))
+		offscreen.push_back({Vertex2D{t[0], red}, Vertex2D{t[1], green}, Vertex2D{t[2], blue}});
+	std::vector<Line<Vertex2D>> offscreen_lines;
+	for (int i = 0; i < 200000; i++)
+		offscreen_lines.push_back({Vertex2D{{U(-w, 2 * w), U(-h, 2 * h)}, red}, Vertex2D{{U(-w, 2 * w), U(-h, 2 * h)}, blue}});
+	measure("clip2d/triangles/offscreen", offscreen.size(), [&] { return 0 * clip(offscreen, rect).size(); });
+	measure("clip2d/lines/offscreen", offscreen_lines.size(), [&] { return 0 * clip(offscreen_lines, rect).size(); });
+
+	// recorte 3D: câmera dentro da nuvem de triângulos
+	mat4 Projection = perspective(45, w / (float)h, 0.1, 100);
+	std::vector<vec3> cloud = random_triangles(200000, 0.3);
+	{
+		BenchShader shader;
+		shader.M = Projection * lookAt({0, 0, 0.5}, {0, 0, -1}, {0, 1, 0});
+		std::vector<BenchShader::Varying> V(cloud.size());
+		for (size_t i = 0; i < cloud.size(); i++)
+			shader.vertexShader(cloud[i], V[i]);
+		auto tris = assemble(Triangles{V.size()}, V);
+
+		measure("clip3d/outcodes/inside", tris.size(), [&]
+		{
+			uint64_t n = 0;
+			for (const auto &T : tris)
+				clip(T, [&](const auto &) { n++; });
+			return 0 * n;
+		});
+		measure("clip3d/polygon/inside", tris.size(), [&]
+		{
+			uint64_t n = 0;
+			for (const auto &T : tris)
+				n += clip(std::vector<BenchShader::Varying>{T[0], T[1], T[2]}).size();
+			return 0 * n;
+		});
+	}
+
+	// pipeline 2D
+	for (const auto &[load, T] : triangle_loads)
+	{
+		if (std::string(load) == "slivers")
+			continue;
+		std::vector<vec2> V;
+		for (const ScreenTriangle &t : T)
+			V.insert(V.end(), t.begin(), t.end());
+		auto draw = [&] { render2d(V, Triangles{V.size()}, red, G); };
+		uint64_t pixels = count_fragments(draw);
+		measure(std::string("pipeline/render2d/") + load, T.size(), [&] { draw(); return pixels; });
+	}
+
+	// pipelines 3D: nuvem vista de fora, câmera dentro da nuvem, malha de metaballs e quadrados texturizados
+	MetaballField figure{0.7, {
+		{1, 1.8, {0, 0, 0}},
+		{1, 0.7, {0, 0.2, 0.8}},
+		{1, 0.5, {0.8, 0, 0}},
+		{1, 0.5, {-0.8, 0, 0}},
+		{1, 0.5, {1.3, 0, 0}},
+		{1, 0.5, {-1.3, 0, 0}},
+	}};
+	IndexedMesh mesh = marchingCubesIndexed(figure, 128, 128, 128, {-2, -2, -2}, {2, 2, 2});
+	measure("marching_cubes/indexed/metaballs", mesh.indices.size() / 3, [&]
+	{
+		mesh = marchingCubesIndexed(figure, 128, 128, 128, {-2, -2, -2}, {2, 2, 2});
+		return 0;
+	});
+
+	std::vector<vec3> small = random_triangles(50000, 0.05);
+	std::vector<vec3> near = random_triangles(20000, 0.1); // câmera dentro: parte é recortada, parte fica fora
+	Elements<Triangles> mesh_triangles{mesh.indices};
+	std::vector<FloorVertex> quads = textured_quads(U, 5000, 0.2);
+
+	BenchRandom texels{7};
+	ImageRGB texture_image{256, 256};
+	for (int y = 0; y < 256; y++)
+		for (int x = 0; x < 256; x++)
+			texture_image(x, y) = RGB{(unsigned char)texels(0, 256), (unsigned char)texels(0, 256), (unsigned char)texels(0, 256)};
+	Sampler2D texture;
+	texture.img = texture_image;
+	texture.filter = BILINEAR;
+	texture.wrapX = texture.wrapY = REPEAT;
+
+	mat4 Outside = Projection * lookAt({0, 0, 3}, {0, 0, 0}, {0, 1, 0});
+	mat4 Inside = Projection * lookAt({0, 0, 0.5}, {0, 0, -1}, {0, 1, 0});
+	mat4 Figure = Projection * lookAt({2.5, 2.5, 1.5}, {0, 0, 0}, {0, 0, 1});
+
+	auto pipelines = [&](const std::string &load, const auto &V, const auto &P, auto shader, size_t primitives)
+	{
+		auto serial = [&]
+		{
+			G.fill(white);
+			ImageZBuffer I{G};
+			Render3D(V, P, shader, I);
+		};
+		auto tiled = [&]
+		{
+			G.fill(white);
+			ImageHiZBuffer I{G};
+			TiledRender3D(V, P, shader, I);
+		};
+		uint64_t serial_pixels = count_fragments(serial), tiled_pixels = count_fragments(tiled);
+		measure("pipeline/render3d/" + load, primitives, [&] { serial(); return serial_pixels; });
+		measure("pipeline/tiled_hiz/" + load, primitives, [&] { tiled(); return tiled_pixels; });
+	};
+
+	BenchShader shader;
+	shader.M = Outside;
+	pipelines("cloud", small, Triangles{small.size()}, shader, small.size() / 3);
+	shader.M = Inside;
+	pipelines("clipping", near, Triangles{near.size()}, shader, near.size() / 3);
+	shader.M = Figure;
+	pipelines("metaballs", mesh.vertices, mesh_triangles, shader, mesh.indices.size() / 3);
+
+	BatchTextureShader texture_shader;
+	texture_shader.M = Outside;
+	texture_shader.texture = &texture;
+	pipelines("textured_quads", quads, Triangles{quads.size()}, texture_shader, quads.size() / 3);
+}
+
+// uso: benchmark [arquivos .obj para o teste de recorte]
+//      benchmark --suite [resultado.json] [largura altura]
+int main(int argc, char *argv[])
+{
+	if (argc > 1 && std::string(argv[1]) == "--suite")
+	{
+		std::string out = argc > 2 ? argv[2] : "benchmark.json";
+		BenchReport report{argc > 4 ? atoi(argv[3]) : 1920, argc > 4 ? atoi(argv[4]) : 1080};
+		bench_suite(report);
+		if (!report.write(out))
+		{
+			fprintf(stderr, "não foi possível gravar %s\n", out.c_str());
+			return 1;
+		}
+		printf("%s\n", out.c_str());
+		return 0;
+	}
+
+	bench_obj_parser(argc, argv);
+	bench_mesh_cache(argc, argv);
+	bench_clip(1920, 1080, argc, argv);
+	bench_frustum_culling(1920, 1080);
+	bench_cluster_culling(1920, 1080);
+	bench_backface_culling(1920, 1080);
+	bench_frame_sequence(600, 600, 24);
+	bench_profiler(1920, 1080);
+	bench_vertex_cache(1920, 1080);
+	bench_soa(1920, 1080);
+	bench_texture_filter(1920, 1080);
+	bench_texture_layout(1920, 1080);
+	bench_texture_batch(1920, 1080);
+	bench_texture_store(10, 40, 512);
+	bench_marching_cubes(256);
+	bench_metaballs(2000, 64);
+	bench_hiz(1920, 1080);
+	bench_msaa(1920, 1080);
+	bench_framebuffer(1920, 1080);
+	bench_lines(1920, 1080);
+	bench_triangle_rasterizers(1920, 1080);
+	bench_tiled(1920, 1080);
+}
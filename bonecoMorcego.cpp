@@ -1,47 +1,15 @@
 #include "Render3D.h"
 #include "ZBuffer.h"
-#include "MarchingCubes.h"
+#include "IndexedMarchingCubes.h"
+#include "ImplicitField.h"
 #include "MixColorShader.h"
 #include "VertexUtils.h"
 #include "transforms.h"
-
-struct Metaball
-{
-	float a;
-	float b;
-	vec3 center;
-
-	float operator()(vec3 P)
-	{
-		float r = norm(P - center);
-
-		return r >= b ? 0.0f : r >= b / 3 ? 3 * a / 2 * pow(1 - r / b, 2)
-										  : a * (1 - 3 * r * r / (b * b));
-	}
-};
-
-struct MetaballFigure
-{
-	float T;
-	std::vector<Metaball> metaballs;
-
-	float operator()(float x, float y, float z)
-	{
-		vec3 P = {x, y, z};
-
-		float sum = 0;
-		for (Metaball fi : metaballs)
-			sum += fi(P);
-
-		return T - sum;
-	}
-};
+#include "FrameSequence.h"
 
 int main()
 {
-	MetaballFigure figure;
-	figure.T = 0.7;
-	figure.metaballs = {
+	MetaballField figure{0.7, {
 		{1, 1.8, {0, 0, 0}},
 		{1, 0.7, {0, 0.2, 0.8}},
 		{1, 0.5, {0.8, 0, 0}},
@@ -52,12 +20,12 @@ int main()
 		{1, 0.5, {-0.5, 0.1, -0.5}},
 		{1, 0.5, {0.5, 0.2, -1}},
 		{1, 0.5, {-0.5, 0.2, -1}},
-	};
+	}};
 
 	vec3 pmin = {-2, -2, -2};
 	vec3 pmax = {2, 2, 2};
 
-	std::vector<vec3> P = marchingCubes(figure, 50, 50, 50, pmin, pmax);
+	IndexedMesh mesh = marchingCubesIndexed(figure, 50, 50, 50, pmin, pmax);
 
 	MixColorShader shader;
 	shader.pmin = pmin;
@@ -66,27 +34,29 @@ int main()
 		cyan, blue, purple, orange,
 		yellow, magenta, red, green};
 
-	Triangles T{P.size()};
+	Elements<Triangles> T{mesh.indices};
 
 	int w = 600, h = 600;
-	ImageRGB G{w, h};
 
 	mat4 View = lookAt({2.5, 2.5, 1.5}, {0, 0, 0}, {0, 0, 1});
 	float a = w / (float)h;
 	mat4 Projection = perspective(45, a, 0.1, 100);
 
+	// os quadros são desenhados em paralelo, cada um com sua imagem e seu ZBuffer,
+	// e gravados em PNG por outras threads
 	int nframes = 80;
-	for (int k = 0; k < nframes; k++)
-	{
-		G.fill(white);
-		ImageZBuffer I{G};
-
-		float theta = k * 2 * M_PI / (nframes - 1);
-		mat4 Model = rotate_z(theta);
-		shader.M = Projection * View * Model;
-
-		Render3D(P, T, shader, I);
-
-		G.save_frame(k, "anim/output", "png");
-	}
+	FrameSequence<ImageZBuffer> sequence{w, h};
+	sequence.run(nframes,
+		[&](int k, ImageRGB &G, ImageZBuffer &I)
+		{
+			G.fill(white);
+
+			float theta = k * 2 * M_PI / (nframes - 1);
+			mat4 Model = rotate_z(theta);
+			MixColorShader frame_shader = shader;
+			frame_shader.M = Projection * View * Model;
+
+			Render3D(mesh.vertices, T, frame_shader, I, FRUSTUM_INTERSECTS, {CULL_BACK}); // a malha é fechada
+		},
+		[](int k, const ImageRGB &G) { G.save_frame(k, "anim/output", "png"); });
 }
@@ -4,7 +4,7 @@
 #include "transforms.h"
 #include "Color.h"
 #include "utilsGL.h"
-#include "ObjMesh.h"
+#include "MeshCache.h"
 
 using Vertex = ObjMesh::Vertex;
 
@@ -43,8 +43,9 @@ public:
 
     GLMesh(std::string obj_file, mat4 _Model, std::string default_texture = "")
     {
-        ObjMesh mesh{obj_file};
-        init_buffers(mesh.getTriangles());
+        CachedObjMesh mesh{obj_file};
+        ArrayView<Vertex> tris = mesh.getTriangles();
+        init_buffers({tris.begin(), tris.end()});
 
         MaterialInfo std_mat;
         std_mat.map_Kd = default_texture;
@@ -0,0 +1,199 @@
+// Versão sem janela do bonecosglfw, para máquinas sem tela: desenha um caminho de câmera
+// lido de um arquivo e escreve os quadros crus (RGB de 8 bits, linhas de cima para baixo)
+// na saída padrão ou em um arquivo/pipe. Por exemplo:
+//
+//   ./bonecosheadless camera.txt - 800 600 | ffmpeg -f rawvideo -pix_fmt rgb24 -s 800x600 -i - out.mp4
+//
+// Cada linha do caminho tem a posição da câmera, o ponto para onde ela olha e, opcionalmente,
+// o ângulo de visão vertical em graus (45 por padrão):
+//
+//   # ex ey ez   cx cy cz   [fovy]
+//   0 1.6 5      0 1.6 0
+//
+// Há dois quadros: um é desenhado enquanto o outro é escrito. Imagens e ZBuffers são
+// reaproveitados de um quadro para o outro. Os tempos por quadro vão para a saída de erros.
+//
+// Com --profile arquivo.json, grava o tempo de cada etapa do pipeline e os contadores de primitivas
+// e fragmentos do caminho inteiro; com --trace arquivo.json, os eventos para o chrome://tracing (Profiler.h).
+// Com --msaa, desenha com 4 amostras por pixel, como o bonecosgl com GLFW_SAMPLES (Multisample.h).
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include "Scene.h"
+#include "FrameSequence.h"
+#include "Benchmark.h"
+
+struct CameraKey
+{
+	vec3 eye, center;
+	float fovy = 45;
+};
+
+// linhas vazias e começadas por # são ignoradas
+std::vector<CameraKey> loadCameraPath(const std::string &file, bool &ok)
+{
+	std::vector<CameraKey> path;
+	std::ifstream in{file};
+	ok = bool(in);
+
+	std::string line;
+	for (int n = 1; std::getline(in, line); n++)
+	{
+		std::istringstream ss{line};
+		std::string first;
+		if (!(ss >> first) || first[0] == '#')
+			continue;
+
+		ss.str(line);
+		ss.clear();
+		CameraKey key;
+		if (!(ss >> key.eye[0] >> key.eye[1] >> key.eye[2] >> key.center[0] >> key.center[1] >> key.center[2]))
+		{
+			fprintf(stderr, "%s:%d: esperado \"ex ey ez cx cy cz [fovy]\"\n", file.c_str(), n);
+			ok = false;
+			continue;
+		}
+		ss >> key.fovy;
+		path.push_back(key);
+	}
+	return path;
+}
+
+// quadro cru, de cima para baixo como os formatos de vídeo (a imagem guarda de baixo para cima)
+bool writeRaw(FILE *out, const ImageRGB &G)
+{
+	for (int y = G.height() - 1; y >= 0; y--)
+		if (fwrite(&G(0, y), sizeof(RGB), G.width(), out) != (size_t)G.width())
+			return false;
+	return true;
+}
+
+// Desenha o caminho em quadros de width x height, com Target como ZBuffer
+// (ImageHiZBuffer, ou ImageMultisample com multiamostragem), e escreve os quadros em out
+template <class Target>
+FrameTimes renderPath(const std::vector<CameraKey> &path, const std::vector<Mesh> &meshes, int width, int height,
+					  FILE *out, bool &written)
+{
+	// uma thread de desenho (o TiledRender3D já usa todos os núcleos), uma de escrita, um quadro na fila
+	FrameSequence<Target> frames{width, height, 1, 1, 1};
+	TextureLODShader shader;
+	written = true;
+
+	return frames.run(
+		path.size(),
+		[&](int k, ImageRGB &G, Target &I)
+		{
+			const CameraKey &key = path[k];
+			mat4 Projection = perspective(key.fovy, width / (float)height, 0.1, 1000);
+			mat4 View = lookAt(key.eye, key.center, {0, 1, 0});
+
+			if constexpr (is_multisample_image<Target>::value)
+			{
+				I.fill(0x00A5DC_rgb);
+				drawScene(meshes, Projection * View, I, shader);
+				I.resolve();
+			}
+			else
+			{
+				G.fill(0x00A5DC_rgb);
+				drawScene(meshes, Projection * View, I, shader);
+			}
+		},
+		[&](int, const ImageRGB &G)
+		{
+			written = written && writeRaw(out, G);
+		});
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<std::string> args;
+	std::string profile_file, trace_file;
+	bool msaa = false;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--msaa")
+			msaa = true;
+		else if (arg == "--profile" && i + 1 < argc)
+			profile_file = argv[++i];
+		else if (arg == "--trace" && i + 1 < argc)
+			trace_file = argv[++i];
+		else
+			args.push_back(arg);
+	}
+
+	if (args.empty())
+	{
+		fprintf(stderr, "uso: %s [--msaa] [--profile arquivo.json] [--trace arquivo.json] caminho_da_camera.txt [saida|-] [largura altura]\n",
+				argv[0]);
+		return 1;
+	}
+
+	std::string output = args.size() > 1 ? args[1] : "-";
+	int width = args.size() > 3 ? atoi(args[2].c_str()) : 800;
+	int height = args.size() > 3 ? atoi(args[3].c_str()) : 600;
+
+	bool ok;
+	std::vector<CameraKey> path = loadCameraPath(args[0], ok);
+	if (!ok || path.empty() || width <= 0 || height <= 0)
+	{
+		fprintf(stderr, "caminho de câmera inválido: %s\n", args[0].c_str());
+		return 1;
+	}
+
+	FILE *out = stdout;
+	if (output != "-")
+		out = fopen(output.c_str(), "wb");
+	if (!out)
+	{
+		fprintf(stderr, "não foi possível abrir %s\n", output.c_str());
+		return 1;
+	}
+#ifdef _WIN32
+	if (out == stdout)
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+	std::vector<Mesh> meshes;
+	loadScene(meshes);
+
+	PipelineProfiler &profiler = pipelineProfiler();
+	profiler.enabled = !profile_file.empty() || !trace_file.empty();
+	profiler.trace = !trace_file.empty();
+	profiler.reset();
+
+	bool written;
+	FrameTimes times = msaa ? renderPath<ImageMultisample>(path, meshes, width, height, out, written)
+							: renderPath<ImageHiZBuffer>(path, meshes, width, height, out, written);
+
+	if (out != stdout)
+		fclose(out);
+	else
+		fflush(out);
+
+	fprintf(stderr, "%zu quadros %dx%d em %.1f ms (%.1f quadros/s)\n", path.size(), width, height, times.total_ms,
+			1000 * path.size() / times.total_ms);
+	fprintf(stderr, "desenho (ms): p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n", percentile(times.render_ms, 50),
+			percentile(times.render_ms, 90), percentile(times.render_ms, 99), percentile(times.render_ms, 100));
+	fprintf(stderr, "escrita (ms): p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n", percentile(times.encode_ms, 50),
+			percentile(times.encode_ms, 90), percentile(times.encode_ms, 99), percentile(times.encode_ms, 100));
+
+	if (!profile_file.empty() && !profiler.writeJSON(profile_file))
+		fprintf(stderr, "não foi possível gravar %s\n", profile_file.c_str());
+	if (!trace_file.empty() && !profiler.writeChromeTrace(trace_file))
+		fprintf(stderr, "não foi possível gravar %s\n", trace_file.c_str());
+
+	if (!written)
+	{
+		fprintf(stderr, "erro ao escrever os quadros em %s\n", output.c_str());
+		return 1;
+	}
+}
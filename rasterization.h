@@ -2,7 +2,13 @@
 #define RASTERIZATION_H
 
 #include <algorithm>
+#include <climits>
 #include <cmath>
+#include <cstdint>
+#include <vector>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
 #include "vec.h"
 #include "geometry.h"
 
@@ -23,23 +29,70 @@ inline vec2 toVec2(Pixel p)
 	return {(float)p.x, (float)p.y};
 }
 
+// retângulo de pixels [x0, x1) x [y0, y1)
+struct PixelRect
+{
+	int x0, y0, x1, y1;
+
+	bool has(Pixel p) const
+	{
+		return p.x >= x0 && p.y >= y0 && p.x < x1 && p.y < y1;
+	}
+};
+
+// Posições das amostras dentro de um pixel, em 1/16 de pixel a partir do centro.
+// São os padrões fixos do Direct3D 11, os mesmos das GPUs (GLFW_SAMPLES no bonecosgl).
+struct SamplePattern
+{
+	int count;
+	int x[16], y[16];
+};
+
+// padrão com samples amostras (1, 2, 4, 8 ou 16; arredondado para baixo)
+inline const SamplePattern &samplePattern(int samples)
+{
+	static const SamplePattern patterns[] = {
+		{1, {0}, {0}},
+		{2, {4, -4}, {4, -4}},
+		{4, {-2, 6, -6, 2}, {-6, -2, 2, 6}},
+		{8, {1, -1, 5, -3, -5, -7, 3, 7}, {-3, 3, 1, -5, 5, -1, 7, -7}},
+		{16, {1, -1, -3, 4, -5, 2, 5, 3, -2, 0, -4, -6, -8, 7, 6, -7}, {1, -3, 2, -1, -2, 5, 3, -5, 6, -7, -6, 4, 0, -4, 7, -8}}};
+	int i = 0;
+	while (i < 4 && patterns[i + 1].count <= samples)
+		i++;
+	return patterns[i];
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
-template <class Line>
-std::vector<Pixel> rasterizeLine(const Line &P)
+// As funções de rasterização recebem um visitante f, chamado para cada
+// pixel gerado, e não alocam memória. As versões que devolvem
+// std::vector<Pixel> apenas coletam esses pixels.
+
+// Chama f(p) para cada pixel p da linha
+template <class Line, class F>
+void rasterizeLine(const Line &P, F f)
 {
-	// return simple(P[0], P[1]);
+	// simple(P[0], P[1], f);
+
+	dda(P[0], P[1], f);
 
-	return dda(P[0], P[1]);
+	// bresenham(toPixel(P[0]), toPixel(P[1]), f);
+}
 
-	// return bresenham(toPixel(P[0]), toPixel(P[1]));
+template <class Line>
+std::vector<Pixel> rasterizeLine(const Line &P)
+{
+	std::vector<Pixel> out;
+	rasterizeLine(P, [&](Pixel p) { out.push_back(p); });
+	return out;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-inline std::vector<Pixel> simple(vec2 A, vec2 B)
+template <class F>
+void simple(vec2 A, vec2 B, F f)
 {
-	std::vector<Pixel> out;
 	vec2 d = B - A;
 	float m = d[1] / d[0];
 	float b = A[1] - m * A[0];
@@ -50,14 +103,21 @@ inline std::vector<Pixel> simple(vec2 A, vec2 B)
 	for (int x = x0; x <= x1; x++)
 	{
 		int y = (int)roundf(m * x + b);
-		out.push_back({x, y});
+		f(Pixel{x, y});
 	}
+}
+
+inline std::vector<Pixel> simple(vec2 A, vec2 B)
+{
+	std::vector<Pixel> out;
+	simple(A, B, [&](Pixel p) { out.push_back(p); });
 	return out;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-inline std::vector<Pixel> dda(vec2 A, vec2 B)
+template <class F>
+void dda(vec2 A, vec2 B, F f)
 {
 	vec2 dif = B - A;
 	float delta = std::max(fabs(dif[0]), fabs(dif[1]));
@@ -65,26 +125,30 @@ inline std::vector<Pixel> dda(vec2 A, vec2 B)
 	vec2 d = (1 / delta) * dif;
 	vec2 p = A;
 
-	std::vector<Pixel> out;
 	for (int i = 0; i <= delta; i++)
 	{
-		out.push_back(toPixel(p));
+		f(toPixel(p));
 		p = p + d;
 	}
+}
+
+inline std::vector<Pixel> dda(vec2 A, vec2 B)
+{
+	std::vector<Pixel> out;
+	dda(A, B, [&](Pixel p) { out.push_back(p); });
 	return out;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-inline std::vector<Pixel> bresenham_base(int dx, int dy)
+template <class F>
+void bresenham_base(int dx, int dy, F f)
 {
-	std::vector<Pixel> out;
-
 	int D = 2 * dy - dx;
 	int y = 0;
 	for (int x = 0; x <= dx; x++)
 	{
-		out.push_back({x, y});
+		f(Pixel{x, y});
 		if (D > 0)
 		{
 			y++;
@@ -92,52 +156,95 @@ inline std::vector<Pixel> bresenham_base(int dx, int dy)
 		}
 		D += 2 * dy;
 	}
-	return out;
 }
 
-inline std::vector<Pixel> bresenham(int dx, int dy)
+template <class F>
+void bresenham(int dx, int dy, F f)
 {
-	std::vector<Pixel> out;
-
 	if (dx >= dy)
-	{
-		out = bresenham_base(dx, dy);
-	}
+		bresenham_base(dx, dy, f);
 	else
-	{
-		out = bresenham_base(dy, dx);
-		for (Pixel &p : out)
-			p = {p.y, p.x};
-	}
-	return out;
+		bresenham_base(dy, dx, [&](Pixel p) { f(Pixel{p.y, p.x}); });
 }
 
-inline std::vector<Pixel> bresenham(Pixel p0, Pixel p1)
+template <class F>
+void bresenham(Pixel p0, Pixel p1, F f)
 {
 	if (p0.x > p1.x)
 		std::swap(p0, p1);
 
-	std::vector<Pixel> out = bresenham(p1.x - p0.x, abs(p1.y - p0.y));
-
 	int s = (p0.y <= p1.y) ? 1 : -1;
 
-	for (Pixel &p : out)
-		p = {p0.x + p.x, p0.y + s * p.y};
+	bresenham(p1.x - p0.x, abs(p1.y - p0.y), [&](Pixel p) { f(Pixel{p0.x + p.x, p0.y + s * p.y}); });
+}
+
+inline std::vector<Pixel> bresenham_base(int dx, int dy)
+{
+	std::vector<Pixel> out;
+	bresenham_base(dx, dy, [&](Pixel p) { out.push_back(p); });
+	return out;
+}
+
+inline std::vector<Pixel> bresenham(int dx, int dy)
+{
+	std::vector<Pixel> out;
+	bresenham(dx, dy, [&](Pixel p) { out.push_back(p); });
+	return out;
+}
 
+inline std::vector<Pixel> bresenham(Pixel p0, Pixel p1)
+{
+	std::vector<Pixel> out;
+	bresenham(p0, p1, [&](Pixel p) { out.push_back(p); });
 	return out;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
+// Chama f(p, t) para cada pixel p do triângulo dentro de R, onde t são
+// as coordenadas baricêntricas de p.
+template <class Tri, class F>
+void rasterizeTriangle(const Tri &P, PixelRect R, F f)
+{
+	rasterizeTriangle(P, R, f, [](PixelRect) { return true; });
+}
+
+// Como acima, mas antes de visitar os pixels de cada bloco chama block(B), com
+// B o retângulo de pixels do bloco; se block devolver false o bloco é descartado.
+template <class Tri, class F, class Block>
+void rasterizeTriangle(const Tri &P, PixelRect R, F f, Block block)
+{
+	edge_functions(P, R, samplePattern(1), [&](Pixel p, vec3 t, unsigned int) { f(p, t); }, block);
+}
+
+// Multiamostragem: chama f(p, t, coverage) para cada pixel p com alguma amostra do padrão S
+// dentro do triângulo. O bit s de coverage indica a amostra s; t são as coordenadas
+// baricêntricas do centro do pixel, que pode estar fora do triângulo.
+template <class Tri, class F, class Block>
+void rasterizeTriangleSamples(const Tri &P, PixelRect R, const SamplePattern &S, F f, Block block)
+{
+	edge_functions(P, R, S, f, block);
+}
+
 template <class Tri>
-std::vector<Pixel> rasterizeTriangle(const Tri &P)
+std::vector<Pixel> rasterizeTriangle(const Tri &P, PixelRect R)
 {
-	// return simple_rasterize_triangle(P);
-	return scanline(P);
+	// simple_rasterize_triangle(P, f);
+	// scanline(P, R, f);
+
+	std::vector<Pixel> out;
+	rasterizeTriangle(P, R, [&](Pixel p, vec3) { out.push_back(p); });
+	return out;
 }
 
 template <class Tri>
-std::vector<Pixel> simple_rasterize_triangle(const Tri &P)
+std::vector<Pixel> rasterizeTriangle(const Tri &P)
+{
+	return rasterizeTriangle(P, {INT_MIN, INT_MIN, INT_MAX, INT_MAX});
+}
+
+template <class Tri, class F>
+void simple_rasterize_triangle(const Tri &P, F f)
 {
 	vec2 A = P[0];
 	vec2 B = P[1];
@@ -148,16 +255,22 @@ std::vector<Pixel> simple_rasterize_triangle(const Tri &P)
 	int ymin = ceil(std::min({A[1], B[1], C[1]}));
 	int ymax = floor(std::max({A[1], B[1], C[1]}));
 
-	std::vector<Pixel> out;
 	Pixel p;
 	for (p.y = ymin; p.y <= ymax; p.y++)
 		for (p.x = xmin; p.x <= xmax; p.x++)
 			if (is_inside(toVec2(p), P))
-				out.push_back(p);
+				f(p);
+}
+
+template <class Tri>
+std::vector<Pixel> simple_rasterize_triangle(const Tri &P)
+{
+	std::vector<Pixel> out;
+	simple_rasterize_triangle(P, [&](Pixel p) { out.push_back(p); });
 	return out;
 }
 
-float intersection(vec2 A, vec2 B, int ys)
+inline float intersection(vec2 A, vec2 B, int ys)
 {
 
 	float x = (((B[0] - A[0]) * (ys - A[1])) / (B[1] - A[1])) + A[0];
@@ -178,38 +291,372 @@ float intersection(vec2 A, vec2 B, int ys)
 	}
 }
 
-template <class Tri>
-std::vector<Pixel> scanline(const Tri &P)
+// Scanline restrita aos pixels do retângulo R.
+// Chama span(y, xmin, xmax) para cada segmento horizontal [xmin, xmax] da linha y.
+template <class Tri, class F>
+void scanline_spans(const Tri &P, PixelRect R, F span)
 {
 	vec2 A = P[0];
 	vec2 B = P[1];
 	vec2 C = P[2];
 
 	// calcula ymin e ymax
-	int ymin = ceil(std::min({A[1], B[1], C[1]}));
-	int ymax = floor(std::max({A[1], B[1], C[1]}));
+	int ymin = std::max<float>(ceil(std::min({A[1], B[1], C[1]})), R.y0);
+	int ymax = std::min<float>(floor(std::max({A[1], B[1], C[1]})), R.y1 - 1);
 
-	std::vector<Pixel> out;
-	Pixel p;
 	// calcula as intersecções entre as scanlines e as arestas usando a função intersection
-	for (p.y = ymin; p.y <= ymax; p.y++)
+	for (int y = ymin; y <= ymax; y++)
 	{
-		float ABx = intersection(A, B, p.y);
-		float BCx = intersection(B, C, p.y);
-		float CAx = intersection(C, A, p.y);
+		float ABx = intersection(A, B, y);
+		float BCx = intersection(B, C, y);
+		float CAx = intersection(C, A, y);
 
 		// dentro do intervalo determinado pela intersecção calcula xmin e xmax
-		int xmin = ceil(fmin(ABx, fmin(BCx, CAx)));
-		int xmax = floor(fmax(ABx, fmax(BCx, CAx)));
+		int xmin = std::max<float>(ceil(fmin(ABx, fmin(BCx, CAx))), R.x0);
+		int xmax = std::min<float>(floor(fmax(ABx, fmax(BCx, CAx))), R.x1 - 1);
+
+		if (xmin <= xmax)
+			span(y, xmin, xmax);
+	}
+}
 
+// Chama f(p) para cada pixel p do triângulo dentro de R
+template <class Tri, class F>
+void scanline(const Tri &P, PixelRect R, F f)
+{
+	scanline_spans(P, R, [&](int y, int xmin, int xmax)
+	{
 		// pinta os pixels dentro do intervalo [xmin,xmax]
-		for (p.x = xmin; p.x <= xmax; p.x++)
+		for (int x = xmin; x <= xmax; x++)
+			f(Pixel{x, y});
+	});
+}
+
+template <class Tri>
+std::vector<Pixel> scanline(const Tri &P, PixelRect R)
+{
+	std::vector<Pixel> out;
+	scanline(P, R, [&](Pixel p) { out.push_back(p); });
+	return out;
+}
+
+template <class Tri>
+std::vector<Pixel> scanline(const Tri &P)
+{
+	return scanline(P, {INT_MIN, INT_MIN, INT_MAX, INT_MAX});
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Rasterização por funções de aresta (half-space)
+//
+// Os vértices são arredondados para 1/16 de pixel e as funções de aresta são
+// avaliadas com inteiros, logo o teste de cobertura é exato. Um pixel sobre
+// uma aresta compartilhada é pintado por exatamente um dos dois triângulos
+// (regra top-left). A tela é percorrida em blocos de 8x8 pixels: blocos fora
+// do triângulo são descartados, blocos totalmente dentro são pintados sem
+// nenhum teste, e os demais são testados uma linha de 8 pixels por vez.
+
+constexpr int SUBPIXEL_BITS = 4;
+constexpr int RASTER_BLOCK = 8;
+
+struct EdgeFunction
+{
+	// E(x, y) = A*x + B*y + C, com (x, y) em pixels.
+	// E >= 0 dentro do triângulo; C já inclui o desempate da regra top-left.
+	int64_t A, B, C;
+	int bias;
+
+	int64_t operator()(int64_t x, int64_t y) const
+	{
+		return A * x + B * y + C;
+	}
+};
+
+// aresta de P0 a P1, com o interior do triângulo à esquerda
+inline EdgeFunction edge_function(int64_t x0, int64_t y0, int64_t x1, int64_t y1)
+{
+	int64_t a = y0 - y1;
+	int64_t b = x1 - x0;
+
+	// pixels exatamente sobre a aresta só pertencem a arestas "left" ou "top"
+	int bias = (a > 0 || (a == 0 && b > 0)) ? 0 : 1;
+
+	return {a << SUBPIXEL_BITS, b << SUBPIXEL_BITS, x0 * y1 - y0 * x1 - bias, bias};
+}
+
+inline int64_t floor_div(int64_t a, int64_t b)
+{
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+// Teste de cobertura de um bloco, uma linha de 8 pixels por vez.
+// w[k] é o valor da aresta k no primeiro pixel da primeira linha,
+// dx[k] e dy[k] os incrementos por coluna e por linha.
+struct BlockCoverage
+{
+#if defined(__AVX2__)
+	__m256i e[3], dy[3];
+
+	BlockCoverage() = default;
+	BlockCoverage(const int32_t w[3], const int32_t dx[3], const int32_t dy_[3])
+	{
+		for (int k = 0; k < 3; k++)
 		{
-			out.push_back(p);
+			int32_t a = w[k], d = dx[k];
+			e[k] = _mm256_setr_epi32(a, a + d, a + 2 * d, a + 3 * d, a + 4 * d, a + 5 * d, a + 6 * d, a + 7 * d);
+			dy[k] = _mm256_set1_epi32(dy_[k]);
 		}
 	}
 
-	return out;
+	// bit i ligado se o pixel i da linha está dentro
+	unsigned int mask() const
+	{
+		__m256i out = _mm256_or_si256(_mm256_or_si256(e[0], e[1]), e[2]);
+		return ~_mm256_movemask_ps(_mm256_castsi256_ps(out)) & 0xFF;
+	}
+
+	void next_row()
+	{
+		for (int k = 0; k < 3; k++)
+			e[k] = _mm256_add_epi32(e[k], dy[k]);
+	}
+#elif defined(__SSE2__)
+	__m128i lo[3], hi[3], dy[3];
+
+	BlockCoverage() = default;
+	BlockCoverage(const int32_t w[3], const int32_t dx[3], const int32_t dy_[3])
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			int32_t a = w[k], d = dx[k];
+			lo[k] = _mm_setr_epi32(a, a + d, a + 2 * d, a + 3 * d);
+			hi[k] = _mm_setr_epi32(a + 4 * d, a + 5 * d, a + 6 * d, a + 7 * d);
+			dy[k] = _mm_set1_epi32(dy_[k]);
+		}
+	}
+
+	unsigned int mask() const
+	{
+		__m128i l = _mm_or_si128(_mm_or_si128(lo[0], lo[1]), lo[2]);
+		__m128i h = _mm_or_si128(_mm_or_si128(hi[0], hi[1]), hi[2]);
+		unsigned int outside = _mm_movemask_ps(_mm_castsi128_ps(l)) | (_mm_movemask_ps(_mm_castsi128_ps(h)) << 4);
+		return ~outside & 0xFF;
+	}
+
+	void next_row()
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			lo[k] = _mm_add_epi32(lo[k], dy[k]);
+			hi[k] = _mm_add_epi32(hi[k], dy[k]);
+		}
+	}
+#else
+	int32_t e[3], dx[3], dy[3];
+
+	BlockCoverage() = default;
+	BlockCoverage(const int32_t w[3], const int32_t dx_[3], const int32_t dy_[3])
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			e[k] = w[k];
+			dx[k] = dx_[k];
+			dy[k] = dy_[k];
+		}
+	}
+
+	unsigned int mask() const
+	{
+		unsigned int m = 0;
+		for (int i = 0; i < RASTER_BLOCK; i++)
+			if (((e[0] + i * dx[0]) | (e[1] + i * dx[1]) | (e[2] + i * dx[2])) >= 0)
+				m |= 1u << i;
+		return m;
+	}
+
+	void next_row()
+	{
+		for (int k = 0; k < 3; k++)
+			e[k] += dy[k];
+	}
+#endif
+};
+
+// Com mais de uma amostra no padrão S, as funções de aresta são avaliadas em cada amostra
+// e f(p, t, coverage) recebe as amostras cobertas; com uma, coverage é sempre 1.
+template <class Tri, class F, class Block>
+void edge_functions(const Tri &P, PixelRect R, const SamplePattern &S, F f, Block block)
+{
+	const float limit = 1 << 26; // mantém os produtos das funções de aresta em 64 bits
+
+	int64_t X[3], Y[3];
+	for (int i = 0; i < 3; i++)
+	{
+		vec2 v = P[i];
+		if (!(fabs(v[0]) < limit && fabs(v[1]) < limit))
+			return;
+		X[i] = llround(v[0] * (1 << SUBPIXEL_BITS));
+		Y[i] = llround(v[1] * (1 << SUBPIXEL_BITS));
+	}
+
+	int64_t area = (X[1] - X[0]) * (Y[2] - Y[0]) - (Y[1] - Y[0]) * (X[2] - X[0]);
+	if (area == 0)
+		return;
+
+	// orientação anti-horária: troca os vértices 1 e 2 e lembra de destrocar as baricêntricas
+	bool swapped = area < 0;
+	if (swapped)
+	{
+		std::swap(X[1], X[2]);
+		std::swap(Y[1], Y[2]);
+		area = -area;
+	}
+
+	EdgeFunction E[3] = {
+		edge_function(X[1], Y[1], X[2], Y[2]),
+		edge_function(X[2], Y[2], X[0], Y[0]),
+		edge_function(X[0], Y[0], X[1], Y[1])};
+
+	// valor de cada aresta em cada amostra, relativo ao centro do pixel, e seus extremos
+	const int64_t U = 1 << SUBPIXEL_BITS;
+	int64_t offset[3][16], omin[3], omax[3];
+	int sx0 = 0, sx1 = 0, sy0 = 0, sy1 = 0;
+	for (int k = 0; k < 3; k++)
+	{
+		omin[k] = omax[k] = offset[k][0] = E[k].A / U * S.x[0] + E[k].B / U * S.y[0];
+		for (int s = 1; s < S.count; s++)
+		{
+			offset[k][s] = E[k].A / U * S.x[s] + E[k].B / U * S.y[s];
+			omin[k] = std::min(omin[k], offset[k][s]);
+			omax[k] = std::max(omax[k], offset[k][s]);
+		}
+	}
+	for (int s = 0; s < S.count; s++)
+	{
+		sx0 = std::min(sx0, S.x[s]);
+		sx1 = std::max(sx1, S.x[s]);
+		sy0 = std::min(sy0, S.y[s]);
+		sy1 = std::max(sy1, S.y[s]);
+	}
+
+	// retângulo envolvente, em pixels, restrito a R
+	int xmin = std::max<int64_t>(-floor_div(sx1 - std::min({X[0], X[1], X[2]}), U), R.x0);
+	int ymin = std::max<int64_t>(-floor_div(sy1 - std::min({Y[0], Y[1], Y[2]}), U), R.y0);
+	int xmax = std::min<int64_t>(floor_div(std::max({X[0], X[1], X[2]}) - sx0, U), R.x1 - 1);
+	int ymax = std::min<int64_t>(floor_div(std::max({Y[0], Y[1], Y[2]}) - sy0, U), R.y1 - 1);
+	if (xmin > xmax || ymin > ymax)
+		return;
+
+	// com arestas muito longas os valores dentro de um bloco não cabem em 32 bits
+	bool simd = true;
+	for (const EdgeFunction &e : E)
+		simd = simd && std::max(std::abs(e.A), std::abs(e.B)) < (1 << 26);
+
+	const int n = RASTER_BLOCK - 1;
+	const double inv_area = 1.0 / area;
+
+	int bx0 = floor_div(xmin, RASTER_BLOCK) * RASTER_BLOCK;
+	int by0 = floor_div(ymin, RASTER_BLOCK) * RASTER_BLOCK;
+
+	for (int by = by0; by <= ymax; by += RASTER_BLOCK)
+		for (int bx = bx0; bx <= xmax; bx += RASTER_BLOCK)
+		{
+			int64_t e[3];
+			bool outside = false;
+			bool inside = true;
+			int32_t w[3], dx[3], dy[3];
+			for (int k = 0; k < 3; k++)
+			{
+				const EdgeFunction &Ek = E[k];
+				e[k] = Ek(bx, by);
+				int64_t lo = e[k] + std::min<int64_t>(Ek.A, 0) * n + std::min<int64_t>(Ek.B, 0) * n + omin[k];
+				int64_t hi = e[k] + std::max<int64_t>(Ek.A, 0) * n + std::max<int64_t>(Ek.B, 0) * n + omax[k];
+				outside = outside || hi < 0;
+
+				// arestas que não cruzam o bloco não precisam ser testadas
+				bool crosses = lo < 0;
+				inside = inside && !crosses;
+				w[k] = crosses ? e[k] : 0;
+				dx[k] = crosses ? Ek.A : 0;
+				dy[k] = crosses ? Ek.B : 0;
+			}
+			if (outside)
+				continue;
+
+			int x0 = std::max(bx, xmin) - bx;
+			int x1 = std::min(bx + n, xmax) - bx;
+			int y0 = std::max(by, ymin) - by;
+			int y1 = std::min(by + n, ymax) - by;
+			unsigned int columns = ((2u << x1) - 1) & ~((1u << x0) - 1);
+
+			if (!block(PixelRect{bx + x0, by + y0, bx + x1 + 1, by + y1 + 1}))
+				continue;
+
+			// baricêntricas no canto do bloco e suas derivadas
+			float t0[3], tdx[3], tdy[3];
+			for (int k = 0; k < 3; k++)
+			{
+				t0[k] = (e[k] + E[k].bias) * inv_area;
+				tdx[k] = E[k].A * inv_area;
+				tdy[k] = E[k].B * inv_area;
+			}
+
+			if (!inside && simd)
+			{
+				for (int k = 0; k < 3; k++)
+					w[k] += y0 * dy[k];
+			}
+			// uma cobertura por amostra: a linha de 8 pixels é testada em cada amostra
+			BlockCoverage coverage[16];
+			for (int s = 0; s < S.count; s++)
+			{
+				int32_t ws[3];
+				for (int k = 0; k < 3; k++)
+					ws[k] = dx[k] || dy[k] ? w[k] + (int32_t)offset[k][s] : 0;
+				coverage[s] = BlockCoverage{ws, dx, dy};
+			}
+
+			for (int j = y0; j <= y1; j++)
+			{
+				unsigned int mask = 0, sample_mask[16];
+				for (int s = 0; s < S.count; s++)
+				{
+					unsigned int m = columns;
+					if (!inside)
+					{
+						if (simd)
+							m &= coverage[s].mask();
+						else
+						{
+							int64_t x = bx * U + S.x[s], y = (by + j) * U + S.y[s];
+							for (int i = x0; i <= x1; i++)
+								for (const EdgeFunction &Ek : E)
+									if (Ek.A / U * (x + i * U) + Ek.B / U * y + Ek.C < 0)
+										m &= ~(1u << i);
+						}
+						coverage[s].next_row();
+					}
+					sample_mask[s] = m;
+					mask |= m;
+				}
+
+				for (; mask; mask &= mask - 1)
+				{
+					int i = __builtin_ctz(mask);
+					vec3 t = {
+						t0[0] + i * tdx[0] + j * tdy[0],
+						t0[1] + i * tdx[1] + j * tdy[1],
+						t0[2] + i * tdx[2] + j * tdy[2]};
+					if (swapped)
+						std::swap(t[1], t[2]);
+
+					unsigned int covered = 0;
+					for (int s = 0; s < S.count; s++)
+						covered |= ((sample_mask[s] >> i) & 1) << s;
+					f(Pixel{bx + i, by + j}, t, covered);
+				}
+			}
+		}
 }
 
 #endif